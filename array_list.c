@@ -1,43 +1,71 @@
 #include <stdlib.h>
+#include <string.h>
 #include "array_list.h"
 
-#define DEFAULT_CAPACITY 256
+#define GROWTH_FACTOR 2
 
+static int ar_is_inline( array_list_t* array_check )
+{
+    return array_check->array_data == array_check->inline_data;
+}
 
-int ar_check_for_resize( array_list_t* array_check )
+static int ar_grow( array_list_t* array_check, uint32_t new_capacity )
 {
     void* new_data = NULL;
-    unsigned int new_capacity;
 
-    if( array_check->size + 1 >= array_check->capacity )
+    if( ar_is_inline( array_check ) )
         {
-
-            new_capacity = array_check->capacity * 2;
-            new_data = realloc( array_check->array_data, new_capacity * sizeof( void* ) );
-
+            new_data = malloc( new_capacity * sizeof( void* ) );
             if( new_data )
                 {
-                    array_check->array_data = (void **) new_data;
-                    array_check->capacity = new_capacity;
-                }
-            else
-                {
-                    return 0;
+                    memcpy( new_data, array_check->inline_data,
+                            array_check->size * sizeof( void* )
+                          );
                 }
         }
+    else
+        {
+            new_data = realloc( array_check->array_data, new_capacity * sizeof( void* ) );
+        }
+
+    if( !new_data )
+        {
+            return 0;
+        }
+
+    array_check->array_data = (void **) new_data;
+    array_check->capacity = new_capacity;
     return 1;
 }
+
+int ar_check_for_resize( array_list_t* array_check )
+{
+    if( array_check->size >= array_check->capacity )
+        {
+            return ar_grow( array_check, array_check->capacity * GROWTH_FACTOR );
+        }
+    return 1;
+}
+
 void ar_init( array_list_t* to_init )
 {
     to_init->size = 0;
-    to_init->capacity = DEFAULT_CAPACITY;
-    to_init->array_data = calloc( DEFAULT_CAPACITY, sizeof( char* ) ); 
+    to_init->capacity = AR_INLINE_CAPACITY;
+    to_init->array_data = to_init->inline_data;
 }
 
+void ar_release( array_list_t* to_release )
+{
+    if( !ar_is_inline( to_release ) )
+        {
+            free( to_release->array_data );
+        }
+    ar_init( to_release );
+}
 
 void ar_clear( array_list_t* to_clear )
 {
-    free( to_clear->array_data );
+    ar_release( to_clear );
     free( to_clear );
 }
 
@@ -87,7 +115,7 @@ void *ar_remove( array_list_t *to_remove, unsigned int remove_index )
         {
             removed_data = to_remove->array_data[ remove_index ];
 
-            for( index = remove_index; index < to_remove->size; index++ )
+            for( index = remove_index; index + 1 < to_remove->size; index++ )
                 {
                     to_remove->array_data[ index ] = to_remove->array_data[ index + 1 ];
                 }
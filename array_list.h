@@ -1,21 +1,41 @@
 #ifndef ARRAY_LIST_H_INCLUDED
 #define ARRAY_LIST_H_INCLUDED
 #include <stdint.h>
+
+#define AR_INLINE_CAPACITY 4
+
+/**
+ * Note: The first AR_INLINE_CAPACITY elements are stored in inline_data,
+ *       array_data only moves to the heap once the list outgrows it.
+ *       Because array_data may point into the struct itself, an
+ *       array_list_t must not be copied by value after initialization.
+ **/
 typedef struct array_list_t
 {
     uint32_t size;
     uint32_t capacity;
 
     void **array_data;
+    void *inline_data[ AR_INLINE_CAPACITY ];
 } array_list_t;
 
 /**
  * Initializes an array_list_t object by setting size to zero,
- * and allocating capacity for array_data
+ * and pointing array_data at the list's inline storage
+ * Note: No memory is allocated until the list holds more than
+ *       AR_INLINE_CAPACITY elements
  * @param to_init pointer to array_list_t object to initialize
  **/
 void ar_init( array_list_t* to_init );
 
+/**
+ * Frees the storage owned by an array list, but not the
+ * array_list_t itself. Use for lists that live on the stack
+ * or inside another struct.
+ * @param to_release pointer to array_list_t whose storage to free
+ **/
+void ar_release( array_list_t* to_release );
+
 /**
  * clears an arraylist object, frees each object in 
  * array_data, and then frees to_clear itself
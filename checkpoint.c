@@ -0,0 +1,286 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+
+#define TEMP_SUFFIX ".tmp"
+
+// header fields after the magic: version, first oligo, oligos, oligos done,
+// rows, score columns, window size, mismatches, score mode, blosum cutoff
+#define NUM_HEADER_FIELDS 10
+
+static char *copy_string( const char *source )
+{
+    char *copy = malloc( strlen( source ) + 1 );
+
+    strcpy( copy, source );
+    return copy;
+}
+
+void checkpoint_init( checkpoint_t *checkpoint, uint32_t num_rows,
+                      uint32_t num_score_columns
+                    )
+{
+    uint32_t index;
+
+    checkpoint->first_oligo = 0;
+    checkpoint->num_oligos  = 0;
+    checkpoint->oligos_done = 0;
+    checkpoint->num_rows    = num_rows;
+    checkpoint->num_score_columns = num_score_columns;
+
+    checkpoint->window_size    = 0;
+    checkpoint->num_mismatches = 0;
+    score_settings_init( &checkpoint->scoring, SCORE_MISMATCHES, NULL, 0 );
+    checkpoint->reference_file = copy_string( "" );
+    checkpoint->design_files = malloc( num_score_columns * sizeof( char* ) );
+    for( index = 0; index < num_score_columns; index++ )
+        {
+            checkpoint->design_files[ index ] = copy_string( "" );
+        }
+
+    checkpoint->codes  = calloc( num_rows, sizeof( kmer_code_t ) );
+    checkpoint->scores = calloc( (size_t) num_rows * num_score_columns, sizeof( uint32_t ) );
+}
+
+void checkpoint_clear( checkpoint_t *checkpoint )
+{
+    uint32_t index;
+
+    for( index = 0; checkpoint->design_files && index < checkpoint->num_score_columns; index++ )
+        {
+            free( checkpoint->design_files[ index ] );
+        }
+    free( checkpoint->design_files );
+    free( checkpoint->reference_file );
+    score_settings_clear( &checkpoint->scoring );
+
+    free( checkpoint->codes );
+    free( checkpoint->scores );
+    checkpoint->design_files   = NULL;
+    checkpoint->reference_file = NULL;
+    checkpoint->codes  = NULL;
+    checkpoint->scores = NULL;
+}
+
+void checkpoint_set_run( checkpoint_t *checkpoint, uint32_t window_size,
+                         uint32_t num_mismatches, const score_settings_t *scoring,
+                         const char *reference_file, char **design_files
+                       )
+{
+    uint32_t index;
+
+    checkpoint->window_size    = window_size;
+    checkpoint->num_mismatches = num_mismatches;
+
+    score_settings_clear( &checkpoint->scoring );
+    score_settings_init( &checkpoint->scoring, scoring->mode, scoring->blosum_file,
+                         scoring->blosum_cutoff
+                       );
+
+    free( checkpoint->reference_file );
+    checkpoint->reference_file = copy_string( reference_file );
+
+    for( index = 0; index < checkpoint->num_score_columns; index++ )
+        {
+            free( checkpoint->design_files[ index ] );
+            checkpoint->design_files[ index ] = copy_string( design_files[ index ] );
+        }
+}
+
+int checkpoint_write( checkpoint_t *checkpoint, const char *file_name )
+{
+    char *temp_name = malloc( strlen( file_name ) + strlen( TEMP_SUFFIX ) + 1 );
+    FILE *out_file = NULL;
+    uint32_t header[ NUM_HEADER_FIELDS ] = { CHECKPOINT_VERSION, checkpoint->first_oligo,
+                                             checkpoint->num_oligos, checkpoint->oligos_done,
+                                             checkpoint->num_rows, checkpoint->num_score_columns,
+                                             checkpoint->window_size, checkpoint->num_mismatches,
+                                             checkpoint->scoring.mode,
+                                             (uint32_t) checkpoint->scoring.blosum_cutoff
+                                           };
+    size_t num_rows = checkpoint->num_rows;
+    size_t num_scores = num_rows * checkpoint->num_score_columns;
+    uint32_t index;
+    int success = 0;
+
+    strcpy( temp_name, file_name );
+    strcat( temp_name, TEMP_SUFFIX );
+
+    out_file = fopen( temp_name, "wb" );
+    if( !out_file )
+        {
+            free( temp_name );
+            return 0;
+        }
+
+    success = fwrite( CHECKPOINT_MAGIC, 1, CHECKPOINT_MAGIC_LENGTH, out_file ) == CHECKPOINT_MAGIC_LENGTH
+              && fwrite( header, sizeof( uint32_t ), NUM_HEADER_FIELDS, out_file ) == NUM_HEADER_FIELDS
+              && write_counted_string( out_file, checkpoint->scoring.blosum_file )
+              && write_counted_string( out_file, checkpoint->reference_file );
+
+    for( index = 0; success && index < checkpoint->num_score_columns; index++ )
+        {
+            success = write_counted_string( out_file, checkpoint->design_files[ index ] );
+        }
+
+    success = success
+              && fwrite( checkpoint->codes, sizeof( kmer_code_t ), num_rows, out_file ) == num_rows
+              && fwrite( checkpoint->scores, sizeof( uint32_t ), num_scores, out_file ) == num_scores
+              && fflush( out_file ) == 0
+              && fsync( fileno( out_file ) ) == 0;
+
+    success = fclose( out_file ) == 0 && success;
+
+    // only replace the last good checkpoint with a complete one
+    success = success && rename( temp_name, file_name ) == 0;
+    if( !success )
+        {
+            remove( temp_name );
+        }
+
+    free( temp_name );
+    return success;
+}
+
+int checkpoint_read( checkpoint_t *checkpoint, const char *file_name )
+{
+    FILE *in_file = fopen( file_name, "rb" );
+    char magic[ CHECKPOINT_MAGIC_LENGTH ];
+    uint32_t header[ NUM_HEADER_FIELDS ];
+    uint32_t index;
+    char *read_name = NULL;
+    size_t num_rows;
+    size_t num_scores;
+    int success = 0;
+
+    if( !in_file )
+        {
+            return 0;
+        }
+
+    if( fread( magic, 1, CHECKPOINT_MAGIC_LENGTH, in_file ) != CHECKPOINT_MAGIC_LENGTH
+        || memcmp( magic, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_LENGTH ) != 0
+        || fread( header, sizeof( uint32_t ), NUM_HEADER_FIELDS, in_file ) != NUM_HEADER_FIELDS
+        || header[ 0 ] != CHECKPOINT_VERSION
+        || !check_header_sizes( in_file, header[ 6 ], header[ 4 ], header[ 5 ],
+                                sizeof( kmer_code_t )
+                                + (size_t) header[ 5 ] * sizeof( uint32_t )
+                              )
+      )
+        {
+            fclose( in_file );
+            return 0;
+        }
+
+    checkpoint_init( checkpoint, header[ 4 ], header[ 5 ] );
+    checkpoint->first_oligo = header[ 1 ];
+    checkpoint->num_oligos  = header[ 2 ];
+    checkpoint->oligos_done = header[ 3 ];
+    checkpoint->window_size    = header[ 6 ];
+    checkpoint->num_mismatches = header[ 7 ];
+    num_rows   = checkpoint->num_rows;
+    num_scores = num_rows * checkpoint->num_score_columns;
+
+    read_name = read_counted_string( in_file );
+    success = read_name != NULL;
+    if( success )
+        {
+            score_settings_clear( &checkpoint->scoring );
+            score_settings_init( &checkpoint->scoring, header[ 8 ], read_name,
+                                 (int32_t) header[ 9 ]
+                               );
+            free( read_name );
+        }
+
+    read_name = success ? read_counted_string( in_file ) : NULL;
+    success = read_name != NULL;
+    if( success )
+        {
+            free( checkpoint->reference_file );
+            checkpoint->reference_file = read_name;
+        }
+
+    for( index = 0; success && index < checkpoint->num_score_columns; index++ )
+        {
+            read_name = read_counted_string( in_file );
+            success = read_name != NULL;
+            if( success )
+                {
+                    free( checkpoint->design_files[ index ] );
+                    checkpoint->design_files[ index ] = read_name;
+                }
+        }
+
+    success = success
+              && fread( checkpoint->codes, sizeof( kmer_code_t ), num_rows, in_file ) == num_rows
+              && fread( checkpoint->scores, sizeof( uint32_t ), num_scores, in_file ) == num_scores;
+
+    fclose( in_file );
+
+    if( !success )
+        {
+            checkpoint_clear( checkpoint );
+        }
+    return success;
+}
+
+static void *write_pending( void *writer_ptr )
+{
+    checkpoint_writer_t *writer = writer_ptr;
+
+    writer->success = checkpoint_write( &writer->pending, writer->file_name );
+    checkpoint_clear( &writer->pending );
+    return NULL;
+}
+
+void checkpoint_writer_init( checkpoint_writer_t *writer, const char *file_name )
+{
+    writer->file_name = malloc( strlen( file_name ) + 1 );
+    strcpy( writer->file_name, file_name );
+
+    writer->running = false;
+    writer->success = 1;
+    writer->pending.design_files = NULL;
+    writer->pending.reference_file = NULL;
+    writer->pending.scoring.blosum_file = NULL;
+    writer->pending.codes  = NULL;
+    writer->pending.scores = NULL;
+}
+
+int checkpoint_write_async( checkpoint_writer_t *writer, checkpoint_t *checkpoint )
+{
+    int previous_success = checkpoint_wait( writer );
+
+    writer->pending = *checkpoint;
+
+    if( pthread_create( &writer->thread, NULL, write_pending, writer ) != 0 )
+        {
+            // could not start a thread, write it on this one instead
+            write_pending( writer );
+            return previous_success;
+        }
+
+    writer->running = true;
+    return previous_success;
+}
+
+int checkpoint_wait( checkpoint_writer_t *writer )
+{
+    if( writer->running )
+        {
+            pthread_join( writer->thread, NULL );
+            writer->running = false;
+        }
+    return writer->success;
+}
+
+void checkpoint_writer_clear( checkpoint_writer_t *writer )
+{
+    checkpoint_wait( writer );
+    free( writer->file_name );
+    writer->file_name = NULL;
+}
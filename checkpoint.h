@@ -0,0 +1,148 @@
+#ifndef CHECKPOINT_H_INCLUDED
+#define CHECKPOINT_H_INCLUDED
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "kmer_code.h"
+#include "kmer_results.h"
+
+#define CHECKPOINT_MAGIC "KMCK"
+#define CHECKPOINT_MAGIC_LENGTH 4
+#define CHECKPOINT_VERSION 4
+
+/**
+ * Progress of a counting run over a range of design oligos
+ * Note: scores holds num_score_columns columns of num_rows scores each,
+ *       scores[ c * num_rows + r ] is the score accumulated so far in
+ *       column c by the target kmer packed in codes[ r ]. Oligos are
+ *       counted in order, so the completed oligos are always
+ *       first_oligo up to first_oligo + oligos_done. Column c was
+ *       counted from design_files[ c ] against reference_file.
+ *
+ * On disk, in native byte order:
+ *   magic, version, first_oligo, num_oligos, oligos_done, num_rows,
+ *   num_score_columns, window_size, num_mismatches, score mode,
+ *   blosum cutoff, then the blosum file, reference_file and each design
+ *   file as a uint32_t length and characters, then the codes and scores
+ *   columns
+ **/
+typedef struct checkpoint_t
+{
+    uint32_t first_oligo;
+    uint32_t num_oligos;
+    uint32_t oligos_done;
+    uint32_t num_rows;
+    uint32_t num_score_columns;
+
+    // the counting run that wrote the checkpoint, checked on resume
+    uint32_t window_size;
+    uint32_t num_mismatches;
+    score_settings_t scoring;
+    char *reference_file;
+    char **design_files;
+
+    kmer_code_t *codes;
+    uint32_t *scores;
+} checkpoint_t;
+
+/**
+ * Writes checkpoints on a background thread, one at a time
+ **/
+typedef struct checkpoint_writer_t
+{
+    char *file_name;
+    pthread_t thread;
+    bool running;
+    int success;
+    checkpoint_t pending;
+} checkpoint_writer_t;
+
+/**
+ * Initializes a checkpoint_t, allocating its columns
+ * Note: The run is set to window size and mismatches of zero, with
+ *       SCORE_MISMATCHES and empty reference and design file names,
+ *       use checkpoint_set_run
+ * @param checkpoint pointer to checkpoint_t to initialize
+ * @param num_rows number of target kmers to hold
+ * @param num_score_columns number of scores to hold for each target kmer
+ **/
+void checkpoint_init( checkpoint_t *checkpoint, uint32_t num_rows,
+                      uint32_t num_score_columns
+                    );
+
+/**
+ * Frees the columns of a checkpoint_t, but not the checkpoint_t itself
+ * @param checkpoint pointer to checkpoint_t to clear
+ **/
+void checkpoint_clear( checkpoint_t *checkpoint );
+
+/**
+ * Records the counting run a checkpoint belongs to
+ * Note: The strings are copied
+ * @param checkpoint pointer to checkpoint_t to update
+ * @param window_size number of residues in each kmer
+ * @param num_mismatches mismatch budget the scores are counted with
+ * @param scoring pointer to the score settings the scores are counted with
+ * @param reference_file string name of the reference the targets came from
+ * @param design_files array of num_score_columns design file names
+ **/
+void checkpoint_set_run( checkpoint_t *checkpoint, uint32_t window_size,
+                         uint32_t num_mismatches, const score_settings_t *scoring,
+                         const char *reference_file, char **design_files
+                       );
+
+/**
+ * Writes a checkpoint so that file_name always holds either the
+ * previous checkpoint or this one
+ * Note: The checkpoint is written to file_name with a ".tmp" suffix,
+ *       flushed to disk, then renamed over file_name
+ * @param checkpoint pointer to checkpoint_t to write
+ * @param file_name string name of file to write to
+ * @returns integer boolean success of operation
+ **/
+int checkpoint_write( checkpoint_t *checkpoint, const char *file_name );
+
+/**
+ * Reads a checkpoint written by checkpoint_write
+ * Note: checkpoint must not be initialized, it is initialized on success
+ * @param checkpoint pointer to checkpoint_t to read into
+ * @param file_name string name of file to read
+ * @returns integer boolean success of operation
+ **/
+int checkpoint_read( checkpoint_t *checkpoint, const char *file_name );
+
+/**
+ * Initializes a checkpoint_writer_t
+ * @param writer pointer to checkpoint_writer_t to initialize
+ * @param file_name string name of file checkpoints are written to, copied
+ **/
+void checkpoint_writer_init( checkpoint_writer_t *writer, const char *file_name );
+
+/**
+ * Starts writing a checkpoint on a background thread, first waiting
+ * for any checkpoint that is still being written
+ * Note: The writer takes ownership of the checkpoint's columns and
+ *       names, checkpoint must not be cleared by the caller
+ * @param writer pointer to checkpoint_writer_t to write with
+ * @param checkpoint pointer to checkpoint_t to write
+ * @returns integer boolean success of the previous checkpoint, if any
+ **/
+int checkpoint_write_async( checkpoint_writer_t *writer, checkpoint_t *checkpoint );
+
+/**
+ * Waits for the checkpoint being written, if any
+ * @param writer pointer to checkpoint_writer_t to wait on
+ * @returns integer boolean success of the last checkpoint written
+ **/
+int checkpoint_wait( checkpoint_writer_t *writer );
+
+/**
+ * Waits for the checkpoint being written, then frees the memory held
+ * by writer, but not writer itself
+ * @param writer pointer to checkpoint_writer_t to clear
+ **/
+void checkpoint_writer_clear( checkpoint_writer_t *writer );
+
+#endif
@@ -1,528 +1,1047 @@
+#define _GNU_SOURCE
 #include <pthread.h>
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <omp.h>
 #include <string.h>
 #include <stdbool.h>
 
-#include "hash_table.h"
-#include "array_list.h"
-#include "protein_oligo_library.h"
-
-#ifndef _OPENMP
-    #define omp_get_wtime() 0
-#endif
+#include "kmer_counts.h"
+#include "kmer_code.h"
+#include "kmer_results.h"
+#include "checkpoint.h"
+#include "kernels.h"
 
 const int NUM_ARGS         = 5;
-const int WINDOW_SIZE      = 9;
-const int NUM_MISMATCHES   = 1;
-const int MAX_STRING_SIZE  = 512;
-const int LARGE_TABLE_SIZE = 4000000;
 
-typedef struct kmer
+// design oligos counted between checkpoints unless --checkpoint-every is given
+#define DEFAULT_CHECKPOINT_INTERVAL 10000
+// most window sizes -k accepts in one run
+#define MAX_WINDOW_SIZES 16
+
+// options of one counting run, shared by every window size
+typedef struct run_options
 {
-    char *seq;
-    unsigned int kmer_start;
-    unsigned int kmer_end;
-    unsigned int kmer_score;
-} kmer_t;
-
-static inline bool tolerable_match( char *a, char *b, int size, int num_mismatches );
-static inline void add_valid_kmers( kmer_t **kmers, const unsigned int num_subsets, hash_table_t *table );
-static inline void copy_kmer( kmer_t *dest, kmer_t *src );
-sequence_t **count_and_read_seqs( char *filename );
-static void substring_indices( char *src, char *dest, const int start, const int end );
-static inline int num_substrings( const int str_len, const int window_size );
-static void subset_lists_local( kmer_t **dest_arr, char *seq,
-                                int sequence_len, const int window_size );
-static void subset_lists_ht( hash_table_t *dest, char *seq,
-                              int sequence_len, const int window_size );
-
-hash_table_t *seqs_to_kmer_table( sequence_t **seqs, const int num_seqs );
-void get_kmer_totals( hash_table_t *target_kmers, sequence_t **designed_oligos, int num_oligos, int num_mismatches );
-void get_mismatch_counts( hash_table_t *table, HT_Entry **items, char *kmer,
-                          unsigned int num_items, int num_mismatches
-                        );
-void write_outputs( char *out_file, hash_table_t *table );
-void clear_table( hash_table_t *table );
-void kmer_init( kmer_t *kmer, char *seq, unsigned int start, unsigned int end, unsigned int score );
-void clear_seqs( sequence_t **seqs, int num_seqs );
+    bool reduced_alphabet;
+    bool binary_output;
+
+    // recorded in binary results, and checked against previous results
+    score_settings_t scoring;
+    sort_order_t sort_order;
+    output_filter_t filter;
+
+    // shards are numbered from 1, a num_shards of 0 runs the whole design
+    unsigned int shard_index;
+    unsigned int num_shards;
+
+    char *checkpoint_file_name;
+    int checkpoint_interval;
+    bool resume;
+
+    // with a previous result, the design file holds only the added oligos.
+    // Results record their designs as previous+added-removed
+    char *previous_file_name;
+    char *removed_file_name;
+} run_options_t;
+
+// start of a timed stage
+typedef struct stage_timer
+{
+    double start;
+    uint64_t counts[ NUM_PERF_EVENTS ];
+} stage_timer_t;
+
+static const struct option LONG_OPTIONS[] =
+{
+    { "blosum",        required_argument, NULL, 'b' },
+    { "blosum-cutoff", required_argument, NULL, 'c' },
+    { "weighted",      no_argument,       NULL, 'w' },
+    { "reduced-alphabet", no_argument,    NULL, 'r' },
+    { "format",        required_argument, NULL, 'f' },
+    { "sort",          required_argument, NULL, 's' },
+    { "min-score",     required_argument, NULL, 'm' },
+    { "top",           required_argument, NULL, 'n' },
+    { "top-per-protein", required_argument, NULL, 'p' },
+    { "shard",         required_argument, NULL, 'S' },
+    { "checkpoint",    required_argument, NULL, 'C' },
+    { "checkpoint-every", required_argument, NULL, 'E' },
+    { "resume",        no_argument,       NULL, 'R' },
+    { "previous",      required_argument, NULL, 'P' },
+    { "removed",       required_argument, NULL, 'D' },
+    { "window-sizes",  required_argument, NULL, 'k' },
+    { "stats",         required_argument, NULL, 'j' },
+    { "trace",         required_argument, NULL, 'T' },
+    { "perf-counters", no_argument,       NULL, 'H' },
+    { "isa",           required_argument, NULL, 'I' },
+    { NULL, 0, NULL, 0 }
+};
+
+bool save_checkpoint( checkpoint_writer_t *writer, hash_table_t *target_kmers,
+                      char *ref_file_name, const design_libraries_t *designs,
+                      char **design_files, const match_params_t *params,
+                      const score_settings_t *scoring,
+                      int first_oligo, int num_oligos, int oligos_done
+                    );
+int restore_checkpoint( hash_table_t *target_kmers, char *file_name,
+                        char *ref_file_name, const design_libraries_t *designs,
+                        char **design_files, const match_params_t *params,
+                        const score_settings_t *scoring,
+                        int first_oligo, int num_oligos
+                      );
+bool load_previous_result( hash_table_t *target_kmers, char *file_name,
+                           char *added_file_name, char *removed_file_name,
+                           bool restore, bool reduced_alphabet,
+                           const score_settings_t *scoring,
+                           const match_params_t *params, char **design_file
+                         );
+bool score_targets( hash_table_t *target_seqs, design_libraries_t *designs,
+                    const match_params_t *params, const run_options_t *options,
+                    char *checkpoint_file_name, char *ref_file_name,
+                    char *outfile_name, int num_seqs_ref
+                  );
+char *window_file_name( const char *file_name, int window_size, bool add_suffix );
+static void start_stage( const match_params_t *params, stage_timer_t *timer );
+static void end_stage( const match_params_t *params, stats_stage_t stage,
+                       const stage_timer_t *timer
+                     );
 
 int main( int argc, char **argv )
 {
 
-    char design_file_name[ MAX_STRING_SIZE ];
     char ref_file_name[ MAX_STRING_SIZE ];
     char outfile_name[ MAX_STRING_SIZE ];
+    char *window_outfile_name = NULL;
+    char *window_checkpoint_name = NULL;
 
     int num_seqs_ref    = 0;
-    int num_seqs_design = 0;
 
     FILE *open_file = NULL;
 
     int num_threads = 0;
 
-    hash_table_t *target_seqs = NULL;
+    hash_table_t **target_tables = NULL;
 
     double start_time = 0;
     double end_time   = 0;
 
-    if( argc != NUM_ARGS )
+    run_stats_t stats;
+    ht_stats_t occupancy;
+    double stats_start = 0;
+    stage_timer_t stage;
+    bool perf_requested = false;
+    bool isa_requested = false;
+    cpu_level_t isa_level = cpu_detect_level();
+    perf_counters_t perf;
+    char *stats_file_name = NULL;
+    char *trace_file_name = NULL;
+    trace_t trace;
+    unsigned int library = 0;
+
+    int option = 0;
+    int blosum_cutoff = DEFAULT_BLOSUM_CUTOFF;
+    char *blosum_file_name = NULL;
+    match_params_t params = { NUM_MISMATCHES, NULL, false, WINDOW_SIZE, &stats, NULL, NULL };
+    run_options_t options;
+
+    int window_sizes[ MAX_WINDOW_SIZES ] = { WINDOW_SIZE };
+    int num_window_sizes = 1;
+    int window_index = 0;
+    int longest_window = WINDOW_SIZE;
+    char *window_list = NULL;
+    char *window_token = NULL;
+    bool success = true;
+
+    design_libraries_t designs;
+
+    stats_init( &stats );
+    memset( &options, 0, sizeof( options ) );
+    options.sort_order = SORT_NONE;
+    options.checkpoint_interval = DEFAULT_CHECKPOINT_INTERVAL;
+
+    while( ( option = getopt_long( argc, argv, "b:c:wrf:s:m:n:p:S:C:E:RP:D:k:j:T:HI:", LONG_OPTIONS, NULL ) ) != -1 )
+        {
+            switch( option )
+                {
+                case 'b':
+                    blosum_file_name = optarg;
+                    break;
+                case 'c':
+                    blosum_cutoff = atoi( optarg );
+                    break;
+                case 'w':
+                    params.weighted = true;
+                    break;
+                case 'r':
+                    options.reduced_alphabet = true;
+                    break;
+                case 'f':
+                    if( !strcmp( optarg, "binary" ) )
+                        {
+                            options.binary_output = true;
+                        }
+                    else if( strcmp( optarg, "tsv" ) )
+                        {
+                            printf( "Unknown output format %s, expected tsv or binary\n", optarg );
+                            return EXIT_FAILURE;
+                        }
+                    break;
+                case 's':
+                    if( !strcmp( optarg, "kmer" ) )
+                        {
+                            options.sort_order = SORT_BY_KMER;
+                        }
+                    else if( !strcmp( optarg, "score" ) )
+                        {
+                            options.sort_order = SORT_BY_SCORE;
+                        }
+                    else
+                        {
+                            printf( "Unknown sort order %s, expected kmer or score\n", optarg );
+                            return EXIT_FAILURE;
+                        }
+                    break;
+                case 'm':
+                    options.filter.min_score = strtoul( optarg, NULL, 10 );
+                    break;
+                case 'n':
+                    options.filter.top = strtoul( optarg, NULL, 10 );
+                    break;
+                case 'p':
+                    options.filter.top_per_protein = strtoul( optarg, NULL, 10 );
+                    break;
+                case 'S':
+                    if( sscanf( optarg, "%u/%u", &options.shard_index, &options.num_shards ) != 2
+                        || options.shard_index < 1 || options.shard_index > options.num_shards
+                      )
+                        {
+                            printf( "Invalid shard %s, expected i/N with 1 <= i <= N\n", optarg );
+                            return EXIT_FAILURE;
+                        }
+                    break;
+                case 'C':
+                    options.checkpoint_file_name = optarg;
+                    break;
+                case 'E':
+                    options.checkpoint_interval = atoi( optarg );
+                    if( options.checkpoint_interval < 1 )
+                        {
+                            printf( "The checkpoint interval must be at least 1 oligo\n" );
+                            return EXIT_FAILURE;
+                        }
+                    break;
+                case 'R':
+                    options.resume = true;
+                    break;
+                case 'P':
+                    options.previous_file_name = optarg;
+                    break;
+                case 'D':
+                    options.removed_file_name = optarg;
+                    break;
+                case 'k':
+                    window_list = optarg;
+                    break;
+                case 'j':
+                    stats_file_name = optarg;
+                    break;
+                case 'T':
+                    trace_file_name = optarg;
+                    break;
+                case 'H':
+                    perf_requested = true;
+                    break;
+                case 'I':
+                    if( !cpu_parse_level( optarg, &isa_level ) )
+                        {
+                            printf( "Invalid instruction set %s, expected auto, baseline, avx2 or avx512\n",
+                                    optarg
+                                  );
+                            return EXIT_FAILURE;
+                        }
+                    isa_requested = true;
+                    break;
+                default:
+                    return EXIT_FAILURE;
+                }
+        }
+
+    if( argc - optind != NUM_ARGS - 1 )
         {
-            printf( "USAGE: get_kmer_counts design_file_name "
-                    "ref_file_name outfile_name num_threads\n"
+            printf( "USAGE: get_kmer_counts [-b blosum_file [-c blosum_cutoff] [-w] | -r] "
+                    "[-f tsv|binary] [-s kmer|score] [-k window_size[,window_size...]] "
+                    "[-m min_score] [-n top] [-p top_per_protein] [--shard i/N] [--stats json_file] [--trace json_file] [--perf-counters] [--isa auto|baseline|avx2|avx512] "
+                    "[--checkpoint file [--checkpoint-every oligos] [--resume]] "
+                    "[--previous results_file [--removed removed_file]] "
+                    "design_file_name[,design_file_name...] ref_file_name outfile_name num_threads\n"
+                    "-m, -n and -p filter the totals after every design is counted, "
+                    "rows kept by -n or -p are written in score order unless -s is given\n"
                   );
             return EXIT_FAILURE;
         }
 
-    strcpy( design_file_name, argv[ 1 ] );
-    strcpy( ref_file_name,    argv[ 2 ] );
-    strcpy( outfile_name,     argv[ 3 ] );
+    if( window_list )
+        {
+            num_window_sizes = 0;
+            longest_window = 0;
+            for( window_token = strtok( window_list, "," ); window_token;
+                 window_token = strtok( NULL, "," )
+               )
+                {
+                    if( num_window_sizes == MAX_WINDOW_SIZES )
+                        {
+                            printf( "At most %d window sizes can be given\n", MAX_WINDOW_SIZES );
+                            return EXIT_FAILURE;
+                        }
+                    window_sizes[ num_window_sizes ] = atoi( window_token );
+                    if( window_sizes[ num_window_sizes ] < 1
+                        || window_sizes[ num_window_sizes ] >= MAX_STRING_SIZE
+                      )
+                        {
+                            printf( "Invalid window size %s\n", window_token );
+                            return EXIT_FAILURE;
+                        }
+                    if( window_sizes[ num_window_sizes ] > longest_window )
+                        {
+                            longest_window = window_sizes[ num_window_sizes ];
+                        }
+                    num_window_sizes++;
+                }
+        }
 
-    open_file = fopen( ref_file_name, "r" );
-    num_seqs_ref = count_seqs_in_file( open_file );
-    fclose( open_file );
+    // binary results, checkpoints and previous results store packed kmers
+    if( longest_window > MAX_PACKED_KMER_LENGTH
+        && ( options.binary_output || options.checkpoint_file_name || options.previous_file_name )
+      )
+        {
+            printf( "Window sizes over %d cannot be used with -f binary, --checkpoint or --previous\n",
+                    MAX_PACKED_KMER_LENGTH
+                  );
+            return EXIT_FAILURE;
+        }
 
-    open_file = fopen( design_file_name, "r" );
-    num_seqs_design = count_seqs_in_file( open_file );
-    fclose( open_file );
+    if( options.reduced_alphabet && blosum_file_name )
+        {
+            printf( "The -r flag cannot be combined with -b\n" );
+            return EXIT_FAILURE;
+        }
 
-    num_threads = atoi( argv[ 4 ] );
+    // partial scores are summed by kmer_results merge, so every
+    // target must be written and in a form that can be merged
+    if( options.num_shards && ( !options.binary_output || options.filter.min_score
+                                || options.filter.top || options.filter.top_per_protein
+                              )
+      )
+        {
+            printf( "The --shard option requires -f binary and cannot be combined with -m, -n or -p\n" );
+            return EXIT_FAILURE;
+        }
 
-    #ifdef _OPENMP
-    omp_set_num_threads( num_threads );
-    #endif
+    if( options.removed_file_name && !options.previous_file_name )
+        {
+            printf( "The --removed option requires a previous result given by --previous\n" );
+            return EXIT_FAILURE;
+        }
 
-    sequence_t **refseqs     = NULL;
-    sequence_t **design_seqs = NULL;
+    // each shard would start from the full previous scores
+    if( options.previous_file_name && options.num_shards )
+        {
+            printf( "The --previous option cannot be combined with --shard\n" );
+            return EXIT_FAILURE;
+        }
 
-    start_time = omp_get_wtime();
-    
-    refseqs     = count_and_read_seqs( ref_file_name );
-    design_seqs = count_and_read_seqs( design_file_name );
+    if( options.previous_file_name && num_window_sizes > 1 )
+        {
+            printf( "The --previous option requires a single window size\n" );
+            return EXIT_FAILURE;
+        }
 
-    target_seqs = seqs_to_kmer_table( refseqs, num_seqs_ref );
+    if( options.resume && !options.checkpoint_file_name )
+        {
+            printf( "The --resume option requires a checkpoint file given by --checkpoint\n" );
+            return EXIT_FAILURE;
+        }
 
-    get_kmer_totals( target_seqs, design_seqs,
-                     num_seqs_design, NUM_MISMATCHES
-                   );
+    if( params.weighted && !blosum_file_name )
+        {
+            printf( "The -w flag requires a blosum file given by -b\n" );
+            return EXIT_FAILURE;
+        }
 
-    write_outputs( outfile_name, target_seqs );
+    if( blosum_file_name )
+        {
+            open_file = fopen( blosum_file_name, "r" );
+            if( !open_file )
+                {
+                    printf( "Unable to open blosum file %s\n", blosum_file_name );
+                    return EXIT_FAILURE;
+                }
+            params.blosum_data = parse_blosum_file( open_file );
+            fclose( open_file );
 
-    end_time = omp_get_wtime();
+            if( !params.blosum_data )
+                {
+                    printf( "Unable to parse blosum file %s\n", blosum_file_name );
+                    return EXIT_FAILURE;
+                }
+            blosum_set_cutoff( params.blosum_data, blosum_cutoff );
+        }
 
-    printf( "Finished in %f seconds\n", end_time - start_time );
+    if( options.reduced_alphabet )
+        {
+            score_settings_init( &options.scoring, SCORE_REDUCED, NULL, 0 );
+        }
+    else if( blosum_file_name )
+        {
+            score_settings_init( &options.scoring,
+                                 params.weighted ? SCORE_WEIGHTED : SCORE_BLOSUM,
+                                 blosum_file_name, blosum_cutoff
+                               );
+        }
+    else
+        {
+            score_settings_init( &options.scoring, SCORE_MISMATCHES, NULL, 0 );
+        }
 
-    clear_seqs( refseqs, num_seqs_ref );
-    clear_seqs( design_seqs, num_seqs_design );
-    clear_table( target_seqs );
+    strcpy( ref_file_name,    argv[ optind + 1 ] );
+    strcpy( outfile_name,     argv[ optind + 2 ] );
 
-    return EXIT_SUCCESS;
-}
+    num_threads = atoi( argv[ optind + 3 ] );
 
-void get_kmer_totals( hash_table_t *target_kmers,
-                      sequence_t **designed_oligos,
-                      int num_oligos, int num_mismatches
-                    )
-{
-    hash_table_t *target_copy  = NULL;
-    hash_table_t *target_ptr   = target_kmers;
-    HT_Entry **items           = NULL;
-    hash_table_t *subset_kmers = NULL;
-    char       *current_oligo  = NULL;
+    #ifdef _OPENMP
+    omp_set_num_threads( num_threads );
+    #endif
 
+    // kernels of the best instruction set the cpu has, unless --isa lowers it
+    if( kernels_init( isa_level ) != isa_level && isa_requested )
+        {
+            fprintf( stderr, "This cpu does not support %s, using %s kernels\n",
+                     cpu_level_name( isa_level ),
+                     cpu_level_name( kernels_level() )
+                   );
+        }
 
-    unsigned int index = 0;
-    
-    items = ht_get_items( target_ptr );
+    if( trace_file_name )
+        {
+            trace_init( &trace, omp_get_max_threads(), DEFAULT_TRACE_CAPACITY );
+            params.trace = &trace;
+        }
 
-    #pragma omp parallel shared( target_ptr, items, designed_oligos ) \
-            private( index, target_copy, current_oligo, subset_kmers )
-    {
-        int oligo_size = designed_oligos[ 0 ]->sequence->size; // assume all oligos are same size
-        int num_subsets = num_substrings( oligo_size, WINDOW_SIZE );
+    if( perf_requested )
+        {
+            // libgomp keeps the same threads for every parallel region of
+            // the same size, so each opens counters that later regions reuse
+            perf_counters_init( &perf, omp_get_max_threads() );
+            #pragma omp parallel
+            {
+                perf_counters_open_thread( &perf, omp_get_thread_num() );
+            }
 
-        unsigned int inner_index = 0;
-        kmer_t *val_copy = NULL;
+            if( !perf.events )
+                {
+                    printf( "Hardware counters are unavailable, check "
+                            "/proc/sys/kernel/perf_event_paranoid. Continuing without them\n"
+                          );
+                    perf_counters_clear( &perf );
+                }
+            else
+                {
+                    params.perf = &perf;
+                    stats.perf_events = perf.events;
 
-        HT_Entry **my_items     = NULL;
-        HT_Entry **subset_items = NULL;
-        HT_Entry *current_item  = NULL;
+                    // counts go next to the stage times
+                    if( !stats_file_name )
+                        {
+                            stats_file_name = "-";
+                        }
+                }
+        }
+    stats.oligo_table_stats = stats_file_name != NULL;
 
-        kmer_t *current_val = NULL;
+    stats_start = stats_time();
+    start_stage( &params, &stage );
 
-        target_copy  = malloc( sizeof( hash_table_t ) );
-        subset_kmers = malloc( sizeof( hash_table_t ) );
+    open_file = fopen( ref_file_name, "r" );
+    num_seqs_ref = count_seqs_in_file( open_file );
+    fclose( open_file );
 
-        ht_init( target_copy, LARGE_TABLE_SIZE );
+    sequence_t **refseqs     = NULL;
 
-        for( index = 0; index < target_ptr->size; index++ )
-            {
-                val_copy = malloc( sizeof( kmer_t ) );
-                copy_kmer( val_copy, items[ index ]->value );
-                ht_add( target_copy, items[ index ]->key,
-                        val_copy );
-            }
+    start_time = omp_get_wtime();
+    
+    refseqs     = count_and_read_seqs( ref_file_name );
+    end_stage( &params, STAGE_READ_REFERENCE, &stage );
+    stats.bytes_read += stats_file_size( ref_file_name );
 
-        #pragma omp for
-        for( index = 0; index < (unsigned int) num_oligos; index++ )
-            {
-                ht_init( subset_kmers, num_subsets );
-                current_oligo = designed_oligos[ index ]->sequence->data;
+    start_stage( &params, &stage );
+    if( !read_design_libraries( &designs, argv[ optind ] ) )
+        {
+            return EXIT_FAILURE;
+        }
+    end_stage( &params, STAGE_READ_DESIGNS, &stage );
+    for( library = 0; library < designs.num_libraries; library++ )
+        {
+            stats.bytes_read += stats_file_size( designs.file_names[ library ] );
+        }
 
-                subset_lists_ht( subset_kmers, current_oligo,
-                                 oligo_size, WINDOW_SIZE
-                               );
+    if( options.previous_file_name && designs.num_libraries > 1 )
+        {
+            printf( "The --previous option requires a single design library\n" );
+            return EXIT_FAILURE;
+        }
 
-                subset_items = ht_get_items( subset_kmers );
+    // every window size's targets come from one pass over the reference
+    start_stage( &params, &stage );
+    target_tables = seqs_to_kmer_tables( refseqs, num_seqs_ref,
+                                         window_sizes, num_window_sizes, &stats
+                                       );
+    end_stage( &params, STAGE_BUILD_TABLE, &stage );
 
-                for( inner_index = 0; inner_index < subset_kmers->size; inner_index++ )
-                    {
+    for( window_index = 0; window_index < num_window_sizes; window_index++ )
+        {
+            params.window_size = window_sizes[ window_index ];
+            start_stage( &params, &stage );
+            add_library_scores( target_tables[ window_index ], designs.num_libraries );
+            end_stage( &params, STAGE_BUILD_TABLE, &stage );
+            stats.unique_kmers += target_tables[ window_index ]->size;
+            ht_get_stats( target_tables[ window_index ], &occupancy );
+            stats_add_table( &stats, "target", params.window_size, &occupancy );
+
+            // with several window sizes, each writes its own files
+            window_outfile_name = window_file_name( outfile_name, params.window_size,
+                                                    num_window_sizes > 1
+                                                  );
+            if( options.checkpoint_file_name )
+                {
+                    window_checkpoint_name = window_file_name( options.checkpoint_file_name,
+                                                               params.window_size,
+                                                               num_window_sizes > 1
+                                                             );
+                }
 
+            success = score_targets( target_tables[ window_index ], &designs, &params, &options,
+                                     window_checkpoint_name, ref_file_name,
+                                     window_outfile_name, num_seqs_ref
+                                   ) && success;
 
-                        get_mismatch_counts( target_copy, items, subset_items[ inner_index ]->key,
-                                             target_copy->size, num_mismatches
-                                           );
-                        free( ( (kmer_t*)(subset_items[ inner_index ]->value) )->seq );
-                        free( subset_items[ inner_index ]->value );
-                    }
-                free( subset_items );
-                ht_clear( subset_kmers );
-            }
+            clear_table( target_tables[ window_index ] );
+            free( window_outfile_name );
+            free( window_checkpoint_name );
+        }
+
+    end_time = omp_get_wtime();
+
+    printf( "Finished in %f seconds\n", end_time - start_time );
 
-        free( subset_kmers );
+    if( stats_file_name
+        && !stats_write_json( &stats, stats_time() - stats_start,
+                              omp_get_max_threads(), stats_file_name
+                            )
+      )
+        {
+            printf( "Failed to write stats to %s\n", stats_file_name );
+        }
 
-        my_items = ht_get_items( target_copy );
-        #pragma omp critical
+    if( trace_file_name )
         {
-            for( index = 0; index < target_kmers->size; index++ )
+            if( !trace_write_json( &trace, trace_file_name ) )
                 {
-                    current_item = my_items[ index ];
-                    current_val = (kmer_t*) ht_find( target_kmers, current_item->key );
-                    current_val->kmer_score += ( (kmer_t*) current_item->value)->kmer_score;
+                    printf( "Failed to write trace to %s\n", trace_file_name );
                 }
+            trace_clear( &trace );
         }
 
-        for( index = 0; index < target_kmers->size; index++ )
-            {
-                free( ((kmer_t*)(my_items[ index ]->value))->seq );
-                free( my_items[ index ]->value );
-            }
-        free( my_items );
-
-        ht_clear( target_copy );
-        free( target_copy );
-    }
+    if( params.perf )
+        {
+            perf_counters_clear( params.perf );
+        }
 
-    free( subset_kmers );
-    free( items );
+    clear_seqs( refseqs, num_seqs_ref );
+    clear_design_libraries( &designs );
+    score_settings_clear( &options.scoring );
+    free( target_tables );
 
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
-static inline bool tolerable_match( char *a, char *b, int size, int num_mismatches )
+bool score_targets( hash_table_t *target_seqs, design_libraries_t *designs,
+                    const match_params_t *params, const run_options_t *options,
+                    char *checkpoint_file_name, char *ref_file_name,
+                    char *outfile_name, int num_seqs_ref
+                  )
 {
-    int index = 0;
-    int mismatches = 0;
+    HT_Entry **output_items   = NULL;
+    unsigned int num_output_items = 0;
+
+    // the design files recorded in checkpoints and binary results
+    char **design_files = designs->file_names;
+    char *incremental_design_file = NULL;
+
+    int first_oligo = 0;
+    int num_shard_oligos = designs->num_oligos;
 
+    checkpoint_writer_t checkpoint_writer;
+    int oligos_done = 0;
+    int batch_size  = 0;
+    bool success = true;
+    double span_start  = 0;
+    stage_timer_t stage;
 
-    for( index = 0; index < size; index++ )
+    start_stage( params, &stage );
+    if( options->num_shards )
         {
-            if( a[ index ] - b[ index ] )
+            first_oligo = (int) ( ( (uint64_t) designs->num_oligos * ( options->shard_index - 1 ) )
+                                  / options->num_shards );
+            num_shard_oligos = (int) ( ( (uint64_t) designs->num_oligos * options->shard_index )
+                                       / options->num_shards )
+                               - first_oligo;
+        }
+
+    // a checkpoint already holds the previous result's scores, but the
+    // previous result still names the designs they were counted from
+    if( options->previous_file_name )
+        {
+            if( !load_previous_result( target_seqs, options->previous_file_name,
+                                       designs->file_names[ 0 ], options->removed_file_name,
+                                       !options->resume, options->reduced_alphabet,
+                                       &options->scoring, params, &incremental_design_file
+                                     )
+              )
                 {
-                    mismatches++;
-                    if( mismatches > num_mismatches )
-                        {
-                            return false;
-                        }
+                    return false;
+                }
+            design_files = &incremental_design_file;
+        }
+    if( options->previous_file_name && !options->resume )
+        {
+            params->stats->bytes_read += stats_file_size( options->previous_file_name );
+            if( options->removed_file_name )
+                {
+                    params->stats->bytes_read += stats_file_size( options->removed_file_name );
                 }
         }
-    return true;
-}
-
-sequence_t **count_and_read_seqs( char *filename )
-{
 
-    FILE *open_file = NULL;
-    sequence_t **local_seqs = NULL;
-    int num_seqs = 0;
+    if( options->resume )
+        {
+            oligos_done = restore_checkpoint( target_seqs, checkpoint_file_name,
+                                              ref_file_name, designs, design_files,
+                                              params, &options->scoring,
+                                              first_oligo, num_shard_oligos
+                                            );
+            if( oligos_done < 0 )
+                {
+                    free( incremental_design_file );
+                    return false;
+                }
+            params->stats->bytes_read += stats_file_size( checkpoint_file_name );
+        }
 
-    char local_filename[ MAX_STRING_SIZE ];
+    // without checkpoints every oligo is counted in one batch. Scores are
+    // sums over oligos, so counting in batches gives the same totals
+    batch_size = checkpoint_file_name ? options->checkpoint_interval : num_shard_oligos;
+    if( checkpoint_file_name )
+        {
+            checkpoint_writer_init( &checkpoint_writer, checkpoint_file_name );
+        }
 
-    strcpy( local_filename, filename );
+    while( oligos_done < num_shard_oligos )
+        {
+            if( batch_size > num_shard_oligos - oligos_done )
+                {
+                    batch_size = num_shard_oligos - oligos_done;
+                }
 
-    open_file = fopen( local_filename, "r" );
+            count_oligos( target_seqs, designs, first_oligo + oligos_done,
+                          batch_size, options->reduced_alphabet, params
+                        );
+            oligos_done += batch_size;
+
+            span_start = stats_time();
+            if( checkpoint_file_name && oligos_done < num_shard_oligos
+                && !save_checkpoint( &checkpoint_writer, target_seqs, ref_file_name,
+                                     designs, design_files, params, &options->scoring,
+                                     first_oligo, num_shard_oligos, oligos_done
+                                   )
+              )
+                {
+                    // this snapshot is still being written, the
+                    // status is that of the one before it
+                    printf( "Previous checkpoint write to %s failed\n", checkpoint_file_name );
+                }
+            if( checkpoint_file_name && oligos_done < num_shard_oligos )
+                {
+                    trace_record( params->trace, 0, "checkpoint snapshot", span_start, stats_time() );
+                }
+        }
 
-    num_seqs = count_seqs_in_file( open_file );
+    if( checkpoint_file_name )
+        {
+            if( !checkpoint_wait( &checkpoint_writer ) )
+                {
+                    printf( "Failed to write checkpoint file %s\n", checkpoint_file_name );
+                }
+            checkpoint_writer_clear( &checkpoint_writer );
+        }
 
-    local_seqs = malloc( sizeof( sequence_t *) * num_seqs );
+    end_stage( params, STAGE_COUNT, &stage );
 
-    read_sequences( open_file, local_seqs );
+    start_stage( params, &stage );
+    output_items = ht_get_items( target_seqs );
+    num_output_items = filter_items( output_items, target_seqs->size,
+                                     &options->filter, num_seqs_ref
+                                   );
+    sort_items( output_items, num_output_items, options->sort_order );
+    end_stage( params, STAGE_SORT, &stage );
 
-    fclose( open_file );
+    start_stage( params, &stage );
 
-    return local_seqs;
+    if( options->binary_output )
+        {
+            success = write_binary_outputs( outfile_name, output_items, num_output_items,
+                                            ref_file_name, designs, design_files,
+                                            params, &options->scoring
+                                          );
+        }
+    else
+        {
+            write_outputs( outfile_name, output_items, num_output_items,
+                           designs->num_libraries
+                         );
+        }
+    free( output_items );
+    free( incremental_design_file );
+    end_stage( params, STAGE_WRITE, &stage );
+    params->stats->bytes_written += stats_file_size( outfile_name );
 
+    return success;
 }
 
-static void substring_indices( char *src, char *dest, const int start, const int end )
+char *window_file_name( const char *file_name, int window_size, bool add_suffix )
 {
-    int index       = 0;
-    int inner_index = 0;
+    const char *base_name = strrchr( file_name, '/' );
+    const char *extension = NULL;
+    // room for ".k", the digits of window_size and a terminator
+    char *name = malloc( strlen( file_name ) + 16 );
+    size_t stem_length = 0;
 
-    for( index = start; index < end; index++ )
+    if( !add_suffix )
         {
-            dest[ inner_index ] = src[ index ];
+            strcpy( name, file_name );
+            return name;
+        }
 
-            dest[ ++inner_index ] = '\0';
+    // out.tsv becomes out.k9.tsv, a name without an extension gets .k9 appended
+    base_name = base_name ? base_name + 1 : file_name;
+    extension = strrchr( base_name, '.' );
+    if( !extension || extension == base_name )
+        {
+            extension = file_name + strlen( file_name );
         }
-}
 
-static inline int num_substrings( const int str_len, const int window_size )
-{
-    return str_len - window_size + 1;
+    stem_length = extension - file_name;
+    memcpy( name, file_name, stem_length );
+    sprintf( name + stem_length, ".k%d%s", window_size, extension );
+    return name;
 }
 
-static void subset_lists_local( kmer_t **dest_arr, char *seq,
-                                int sequence_len, const int window_size )
+bool save_checkpoint( checkpoint_writer_t *writer, hash_table_t *target_kmers,
+                      char *ref_file_name, const design_libraries_t *designs,
+                      char **design_files, const match_params_t *params,
+                      const score_settings_t *scoring,
+                      int first_oligo, int num_oligos, int oligos_done
+                    )
 {
-    int seq_len = sequence_len;
-    int num_substr = num_substrings( seq_len, window_size );
-    int index = 0;
-
-    unsigned int start      = 0;
-    unsigned int end        = 0;
-    unsigned const int KMER_SCORE = 0;
-
-    char *substr     = NULL;
-    kmer_t *new_kmer = NULL;
-
-    for( index = 0; index < num_substr; index++ )
+    HT_Entry **items = ht_get_items( target_kmers );
+    checkpoint_t checkpoint;
+    unsigned int index = 0;
+    unsigned int library = 0;
+
+    // snapshot the scores so counting can go on while they are written
+    checkpoint_init( &checkpoint, target_kmers->size, designs->num_libraries );
+    checkpoint.first_oligo = first_oligo;
+    checkpoint.num_oligos  = num_oligos;
+    checkpoint.oligos_done = oligos_done;
+    checkpoint_set_run( &checkpoint, params->window_size, params->num_mismatches,
+                        scoring, ref_file_name, design_files
+                      );
+
+    for( index = 0; index < target_kmers->size; index++ )
         {
-            substr   = malloc( sizeof( char ) * window_size + 1 );
-            new_kmer = malloc( sizeof( kmer_t ) );
-
-            start = index;
-            end   = index + window_size;
-
-            substr[ 0 ] = '\0';
-
-            substring_indices( seq, substr, start,
-                               end
-                             );
-
-            kmer_init( new_kmer, substr, start, end, KMER_SCORE );
-
-            dest_arr[ index ] = new_kmer;
+            checkpoint.codes[ index ] = kmer_pack( items[ index ]->key, params->window_size );
+            for( library = 0; library < designs->num_libraries; library++ )
+                {
+                    checkpoint.scores[ (size_t) library * target_kmers->size + index ] =
+                        library_score( items[ index ]->value, library );
+                }
         }
+    free( items );
+
+    return checkpoint_write_async( writer, &checkpoint );
 }
 
-static void subset_lists_ht( hash_table_t *dest, char *seq,
-                              int sequence_len, const int window_size )
+/**
+ * Sets each score of each target kmer to its stored score, less the
+ * score the target already holds
+ * Note: Targets start with a score of zero, counting oligos into the
+ *       table first takes their contributions off the stored scores.
+ *       scores holds num_columns columns of num_rows scores, one
+ *       column for each design library
+ * @returns boolean true unless a stored kmer is not a target, or
+ *          holds less than the score to take off
+ **/
+static bool restore_scores( hash_table_t *target_kmers, const kmer_code_t *codes,
+                            const uint32_t *scores, uint32_t num_rows,
+                            uint32_t num_columns, int window_size,
+                            const char *file_name
+                          )
 {
-    int seq_len = sequence_len;
-    int num_substr = num_substrings( seq_len, window_size );
-    int index = 0;
-
-    unsigned int start = 0;
-    unsigned int end   = 0;
-    
-    char *substr;
-
-    kmer_t *new_kmer = NULL;
-
-    for( index = 0; index < num_substr; index++ )
+    char kmer[ MAX_PACKED_KMER_LENGTH + 1 ];
+    kmer_t *found = NULL;
+    uint32_t index = 0;
+    uint32_t column = 0;
+    uint32_t stored = 0;
+    unsigned int held  = 0;
+    unsigned int total = 0;
+
+    for( index = 0; index < num_rows; index++ )
         {
-            substr = malloc( sizeof( char ) * window_size + 1 );
-            substr[ 0 ] = '\0';
-
-            start = index;
-            end   = index + window_size;
-            substring_indices( seq, substr, start,
-                               end
-                             );
-
-            if( !ht_find( dest, substr ) )
+            kmer_unpack( codes[ index ], window_size, kmer );
+            found = ht_find( target_kmers, kmer );
+            if( !found )
                 {
-                    new_kmer = malloc( sizeof( kmer_t ) );
+                    printf( "%s holds kmer %s, which is not a target\n", file_name, kmer );
+                    return false;
+                }
 
-                    kmer_init( new_kmer, substr,
-                               start, end, 0
-                             );
-                    ht_add( dest, new_kmer->seq, new_kmer );
+            total = 0;
+            for( column = 0; column < num_columns; column++ )
+                {
+                    stored = scores[ (size_t) column * num_rows + index ];
+                    held   = library_score( found, column );
+                    if( held > stored )
+                        {
+                            printf( "%s holds a score of %u for kmer %s, less than the %u being removed\n",
+                                    file_name, stored, kmer, held
+                                  );
+                            return false;
+                        }
+                    if( found->library_scores )
+                        {
+                            found->library_scores[ column ] = stored - held;
+                        }
+                    total += stored - held;
                 }
+            found->kmer_score = total;
         }
+    return true;
 }
 
-hash_table_t *seqs_to_kmer_table( sequence_t **seqs, const int num_seqs )
+int restore_checkpoint( hash_table_t *target_kmers, char *file_name,
+                        char *ref_file_name, const design_libraries_t *designs,
+                        char **design_files, const match_params_t *params,
+                        const score_settings_t *scoring,
+                        int first_oligo, int num_oligos
+                      )
 {
-    hash_table_t *table = NULL;
-    kmer_t **kmer_arr   = NULL;
-
-    int index       = 0;
-    int num_subsets = 0;
-
-    table = malloc( sizeof( hash_table_t ) );
-    ht_init( table, LARGE_TABLE_SIZE );
+    checkpoint_t checkpoint;
+    char checkpoint_text[ SCORE_SETTINGS_TEXT_LENGTH ];
+    char scoring_text[ SCORE_SETTINGS_TEXT_LENGTH ];
+    unsigned int library = 0;
+    int oligos_done = -1;
 
-    for( index = 0; index < num_seqs; index++ )
+    if( !checkpoint_read( &checkpoint, file_name ) )
         {
-            num_subsets = num_substrings( strlen( seqs[ index ]->sequence->data ), WINDOW_SIZE );
-            kmer_arr = malloc( sizeof( kmer_t*) * num_subsets );
-            subset_lists_local( kmer_arr, seqs[ index ]->sequence->data,
-                                seqs[ index ]->sequence->size, WINDOW_SIZE );
-
-            add_valid_kmers( kmer_arr, num_subsets, table );
+            printf( "Unable to read checkpoint file %s\n", file_name );
+            return -1;
+        }
 
-            free( kmer_arr );
+    if( checkpoint.window_size != (uint32_t) params->window_size
+        || checkpoint.num_mismatches != (uint32_t) params->num_mismatches
+      )
+        {
+            printf( "Checkpoint file %s was written with window size %u and %u mismatches, "
+                    "not %d and %d\n", file_name, checkpoint.window_size,
+                    checkpoint.num_mismatches, params->window_size, params->num_mismatches
+                  );
+            checkpoint_clear( &checkpoint );
+            return -1;
         }
 
-    return table;
-}
-void get_mismatch_counts( hash_table_t *table, HT_Entry **items, char *kmer,
-                          unsigned int num_items, int num_mismatches
-                     )
+    if( checkpoint.first_oligo != (uint32_t) first_oligo
+        || checkpoint.num_oligos != (uint32_t) num_oligos
+        || checkpoint.num_rows != target_kmers->size
+        || checkpoint.num_score_columns != designs->num_libraries
+      )
+        {
+            printf( "Checkpoint file %s was written for different inputs\n", file_name );
+            checkpoint_clear( &checkpoint );
+            return -1;
+        }
 
-{
-    unsigned int index = 0;
-    unsigned int oligo_size = strlen( items[ 0 ]->key );
-    kmer_t *value = NULL;
-    HT_Entry *current_item = NULL;
+    if( !score_settings_equal( &checkpoint.scoring, scoring ) )
+        {
+            score_settings_text( checkpoint_text, &checkpoint.scoring );
+            score_settings_text( scoring_text, scoring );
+            printf( "Checkpoint file %s was scored with %s, not %s\n", file_name,
+                    checkpoint_text, scoring_text
+                  );
+            checkpoint_clear( &checkpoint );
+            return -1;
+        }
 
-    for( index = 0; index < num_items; index++ )
+    if( strcmp( checkpoint.reference_file, ref_file_name ) )
         {
-            current_item = items[ index ];
+            printf( "Checkpoint file %s was written for reference file %s, not %s\n",
+                    file_name, checkpoint.reference_file, ref_file_name
+                  );
+            checkpoint_clear( &checkpoint );
+            return -1;
+        }
 
-            if( tolerable_match( current_item->key, kmer, oligo_size, num_mismatches ) )
+    for( library = 0; library < designs->num_libraries; library++ )
+        {
+            if( strcmp( checkpoint.design_files[ library ], design_files[ library ] ) )
                 {
-                    value = (kmer_t*) ht_find( table, current_item->key );
-                    value->kmer_score++;
-
+                    printf( "Checkpoint file %s was written for design file %s, not %s\n",
+                            file_name, checkpoint.design_files[ library ],
+                            design_files[ library ]
+                          );
+                    checkpoint_clear( &checkpoint );
+                    return -1;
                 }
-            
         }
-}
 
-void kmer_init( kmer_t *kmer, char *seq,
-                unsigned int start,
-                unsigned int end, unsigned int score
-              )
-{
-    kmer->seq = seq;
+    if( restore_scores( target_kmers, checkpoint.codes, checkpoint.scores,
+                        checkpoint.num_rows, checkpoint.num_score_columns,
+                        params->window_size, file_name
+                      )
+      )
+        {
+            oligos_done = checkpoint.oligos_done;
+        }
 
-    kmer->kmer_start = start;
-    kmer->kmer_end   = end;
-    kmer->kmer_score = score;
+    checkpoint_clear( &checkpoint );
+    return oligos_done;
 }
 
-void write_outputs( char *out_file, hash_table_t *table )
+/**
+ * Names the designs of an incremental result, as the previous result's
+ * design file with the added file appended after a '+' and the removed
+ * file, if any, after a '-'. Chained runs keep extending the name
+ * @returns string the caller frees
+ **/
+static char *incremental_design_name( const char *previous_design_file,
+                                      const char *added_file_name,
+                                      const char *removed_file_name
+                                    )
 {
-    FILE *open_file = fopen( out_file, "w" );
-    HT_Entry **ht_items = ht_get_items( table );
-    HT_Entry *current_item = NULL;
-    kmer_t *current_kmer   = NULL;
-    
-    unsigned int index = 0;
-    const char *HEADER = "Kmer\tScore\tStart\tEnd";
-
-    fprintf( open_file, "%s\n", HEADER );
+    size_t length = strlen( previous_design_file ) + strlen( added_file_name ) + 3
+                    + ( removed_file_name ? strlen( removed_file_name ) : 0 );
+    char *name = malloc( length );
 
-    for( index = 0; index < table->size; index++ )
+    sprintf( name, "%s+%s", previous_design_file, added_file_name );
+    if( removed_file_name )
         {
-            current_item = ht_items[ index ];
-            current_kmer = current_item->value;
-
-            fprintf( open_file, "%s\t%u\t%u\t%u\n",
-                     current_item->key,
-                     current_kmer->kmer_score,
-                     current_kmer->kmer_start,
-                     current_kmer->kmer_end
-                   );
+            strcat( name, "-" );
+            strcat( name, removed_file_name );
         }
-
-
-
-
-    fclose( open_file );
-    free( ht_items );
-    
-    
+    return name;
 }
 
-void clear_table( hash_table_t *table )
+bool load_previous_result( hash_table_t *target_kmers, char *file_name,
+                           char *added_file_name, char *removed_file_name,
+                           bool restore, bool reduced_alphabet,
+                           const score_settings_t *scoring,
+                           const match_params_t *params, char **design_file
+                         )
 {
-    HT_Entry **items = NULL;
-    unsigned int index = 0;
+    kmer_results_t previous;
+    design_libraries_t removed;
+    char previous_text[ SCORE_SETTINGS_TEXT_LENGTH ];
+    char scoring_text[ SCORE_SETTINGS_TEXT_LENGTH ];
+    bool success = false;
 
-    items = ht_get_items( table );
-
-    for( index = 0; index < table->size; index++ )
+    if( !results_read( &previous, file_name ) )
         {
-            free( items[ index ]->value );
+            printf( "Unable to read results file %s\n", file_name );
+            return false;
         }
 
+    if( previous.window_size != (uint32_t) params->window_size
+        || previous.num_mismatches != (uint32_t) params->num_mismatches
+        || previous.num_score_columns != 1
+        || previous.num_rows != target_kmers->size
+      )
+        {
+            printf( "Results file %s does not hold a complete, single-library "
+                    "result for this reference and window size\n", file_name
+                  );
+            results_clear( &previous );
+            return false;
+        }
 
-    ht_clear( table );
-    free( table );
-    free( items );
-}
-
-static inline void add_valid_kmers( kmer_t **kmers, const unsigned int num_subsets, hash_table_t *table )
-{
-    unsigned int index;
-    kmer_t *current_kmer = NULL;
+    // scores of different modes cannot be added to
+    if( !score_settings_equal( &previous.scoring, scoring ) )
+        {
+            score_settings_text( previous_text, &previous.scoring );
+            score_settings_text( scoring_text, scoring );
+            printf( "Results file %s was scored with %s, not %s\n", file_name,
+                    previous_text, scoring_text
+                  );
+            results_clear( &previous );
+            return false;
+        }
 
-    bool delete_flag = false;
+    // when resuming the checkpoint holds these scores already
+    success = !restore;
 
-    for( index = 0; index < num_subsets; index++ )
+    if( restore && removed_file_name )
         {
-            current_kmer = kmers[ index ];
-            if( strchr( current_kmer->seq, 'X' ) == NULL )
+            if( !read_design_libraries( &removed, removed_file_name ) )
                 {
-                    if( !ht_find( table, current_kmer->seq ) )
-                        {
-                            ht_add( table,
-                                    current_kmer->seq,
-                                    current_kmer
-                                    );
-                        }
-                    else
-                        {
-                            delete_flag = true;
-                        }
-                }
-            else
-                {
-                    delete_flag = true;
+                    results_clear( &previous );
+                    return false;
                 }
 
-            if( delete_flag )
-                {
-                    delete_flag = false;
+            // counted from zero scores, these are exactly the
+            // removed oligos' contributions to the previous result
+            count_oligos( target_kmers, &removed, 0, removed.num_oligos,
+                          reduced_alphabet, params
+                        );
+            clear_design_libraries( &removed );
+        }
 
-                    free( current_kmer->seq );
-                    free( current_kmer );
-                }
+    if( restore )
+        {
+            success = restore_scores( target_kmers, previous.codes, previous.scores,
+                                      previous.num_rows, 1, params->window_size, file_name
+                                    );
+        }
+    if( success )
+        {
+            *design_file = incremental_design_name( previous.design_files[ 0 ],
+                                                    added_file_name, removed_file_name
+                                                  );
         }
-}
 
+    results_clear( &previous );
+    return success;
+}
 
-static inline void copy_kmer( kmer_t *dest, kmer_t *src )
+static void start_stage( const match_params_t *params, stage_timer_t *timer )
 {
-    dest->seq = malloc( sizeof( char ) * strlen( src->seq ) + 1 );
-    strcpy( dest->seq, src->seq );
-    dest->kmer_start = src->kmer_start;
-    dest->kmer_end   = src->kmer_end;
-    dest->kmer_score = src->kmer_score;
+    perf_counters_read_all( params->perf, timer->counts );
+    timer->start = stats_time();
 }
- 
-void clear_seqs( sequence_t **seqs, int num_seqs )
+
+static void end_stage( const match_params_t *params, stats_stage_t stage,
+                       const stage_timer_t *timer
+                     )
 {
-    int index = 0;
+    double end = stats_time();
+    uint64_t counts[ NUM_PERF_EVENTS ];
 
-    for( index = 0; index < num_seqs; index++ )
-        {
-            ds_clear( seqs[ index ]->sequence );
-            free( seqs[ index ]->name );
-            free( seqs[ index ] );
-        }
+    perf_counters_read_all( params->perf, counts );
+    params->stats->stage_seconds[ stage ] += end - timer->start;
+    stats_add_perf( params->stats, stage, timer->counts, counts );
+    trace_record( params->trace, 0, stats_stage_name( stage ), timer->start, end );
 }
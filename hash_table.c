@@ -4,6 +4,7 @@
 #include <stdint.h>
 
 #include "hash_table.h"
+#include "kmer_code.h"
 
 #define HASH_NUMBER 3187
 #define ADDITIONAL_SPACE 256
@@ -24,35 +25,52 @@ void ht_init( hash_table_t* table, int size )
     table->table_data = calloc( size + ADDITIONAL_SPACE, sizeof( HT_Entry* ) ); 
     table->capacity = size;
     table->size = 0;
+    table->key_length = 0;
+}
+
+void ht_init_kmers( hash_table_t* table, int size, int key_length )
+{
+    ht_init( table, size );
+    table->key_length = key_length;
+}
+
+// bucket of a key, kmer tables skip strlen and hash the packed codes
+static inline uint32_t ht_index( hash_table_t* table, const char* key )
+{
+    if( table->key_length )
+        {
+            return generate_kmer_hash( key, table->key_length ) % table->capacity;
+        }
+    return generate_hash( key, strlen( key ), HASH_NUMBER ) % table->capacity;
 }
 
 void ht_clear( hash_table_t* table )
+{
+    ht_reset( table );
+    free( table->table_data );
+}
+
+void ht_reset( hash_table_t* table )
 {
     uint32_t index;
     HT_Entry* current_node;
-    for( index = 0; index < table->capacity; index++ )
+    HT_Entry* next_node;
+
+    for( index = 0; index < table->capacity && table->size > 0; index++ )
         {
             current_node = table->table_data[ index ];
-            if( current_node != NULL )
+            while( current_node != NULL )
                 {
-                    while( current_node->next != NULL )
-                        {
-                            current_node = current_node->next;
-                        }
-                    while( current_node->prev != NULL )
-                        {
-                            current_node = current_node->prev;
-                            free( current_node->next->key );
-                            free( current_node->next );
-                        }
-                    free( table->table_data[ index ]->key );
-                    free( table->table_data[ index ] );
-                    table->table_data[ index ] = NULL;
+                    next_node = current_node->next;
+                    free( current_node->key );
+                    free( current_node );
+                    current_node = next_node;
+                    table->size--;
                 }
+            table->table_data[ index ] = NULL;
         }
 
     table->size = 0;
-    free( table->table_data );
 }
 
 
@@ -108,6 +126,34 @@ uint32_t generate_hash( const void *key,  int len, uint32_t seed )
 
 }
 
+// golden ratio multiplier, spreads a packed code over the high bits
+#define KMER_HASH_MULTIPLIER UINT64_C( 0x9e3779b97f4a7c15 )
+
+uint32_t generate_kmer_hash( const char *key, int key_length )
+{
+    uint64_t hash = 0;
+    kmer_code_t code;
+    int index = 0;
+    int end;
+
+    // codes are packed as kmer_pack packs them, MAX_PACKED_KMER_LENGTH
+    // residues at a time, and each code is multiplied into the hash
+    while( index < key_length )
+        {
+            code = 0;
+            end = index + MAX_PACKED_KMER_LENGTH < key_length ?
+                  index + MAX_PACKED_KMER_LENGTH : key_length;
+            for( ; index < end; index++ )
+                {
+                    code = ( code << RESIDUE_BITS ) | residue_to_code( key[ index ] );
+                }
+            hash = ( hash ^ code ) * KMER_HASH_MULTIPLIER;
+            hash ^= hash >> 29;
+        }
+
+    return (uint32_t) ( hash >> 32 );
+}
+
 int ht_add( hash_table_t* table, char* to_add, void* add_val )
 {
     uint32_t item_index;
@@ -123,7 +169,7 @@ int ht_add( hash_table_t* table, char* to_add, void* add_val )
     new_entry->next = NULL;
     new_entry->prev = NULL;
 
-    item_index = generate_hash( to_add, add_len, HASH_NUMBER ) % table->capacity;
+    item_index = ht_index( table, to_add );
 
     // item not already in table
     if( table->table_data[ item_index ] == NULL )
@@ -134,21 +180,21 @@ int ht_add( hash_table_t* table, char* to_add, void* add_val )
         {
             // item hash already in table
             current_node = table->table_data[ item_index ];
-            while( current_node->next != NULL )
+            while( current_node != NULL )
                 {
                     // we don't want to add duplicates
-                    if( strcmp( current_node->key, new_entry->key ) != 0 )
-                        {
-                            // update the value
-                            current_node = current_node->next;
-                        }
-                    else
+                    if( strcmp( current_node->key, new_entry->key ) == 0 )
                         {
                             free( new_entry->key );
                             free( new_entry->value );
                             free( new_entry );
                             return 0;
                         }
+                    if( current_node->next == NULL )
+                        {
+                            break;
+                        }
+                    current_node = current_node->next;
                 }
 
             current_node->next = new_entry;
@@ -163,7 +209,7 @@ int ht_add( hash_table_t* table, char* to_add, void* add_val )
 
 HT_Entry* find_item( hash_table_t* table, char* in_key )
 {
-    uint32_t search_index = generate_hash( in_key, strlen( in_key ), HASH_NUMBER ) % table->capacity;
+    uint32_t search_index = ht_index( table, in_key );
 
 
     HT_Entry* current_node;
@@ -210,7 +256,7 @@ void* ht_delete( hash_table_t* table, char* in_key )
     if( found_node != NULL && found_node->key != NULL )
         {
             return_val = found_node->value;
-            found_index = generate_hash( in_key, strlen( in_key ), HASH_NUMBER ) % table->capacity;
+            found_index = ht_index( table, in_key );
             if( table->table_data[ found_index ] == found_node )
                 {
                     table->table_data[ found_index ] = found_node->next;
@@ -224,6 +270,7 @@ void* ht_delete( hash_table_t* table, char* in_key )
                     found_node->prev->next = found_node->next;
                 }
 
+            free( found_node->key );
             free( found_node );
 
             table->size -= 1;
@@ -305,3 +352,70 @@ HT_Entry *ht_get_items_no_malloc( hash_table_t* input, HT_Entry *data )
         }
     return output;
 }
+
+void ht_get_stats( hash_table_t* table, ht_stats_t* stats )
+{
+    uint32_t index;
+    uint64_t chain_length;
+    HT_Entry* current_node;
+
+    memset( stats, 0, sizeof( ht_stats_t ) );
+    stats->tables  = 1;
+    stats->entries = table->size;
+    stats->buckets = table->capacity;
+    stats->bytes   = ( (uint64_t) table->capacity + ADDITIONAL_SPACE ) * sizeof( HT_Entry* );
+
+    for( index = 0; index < table->capacity; index++ )
+        {
+            chain_length = 0;
+            for( current_node = table->table_data[ index ]; current_node != NULL;
+                 current_node = current_node->next
+               )
+                {
+                    chain_length++;
+                    stats->probes += chain_length;
+                    stats->bytes  += sizeof( HT_Entry ) + strlen( current_node->key ) + 1;
+                }
+
+            stats->empty_buckets += chain_length == 0;
+            if( chain_length > 1 )
+                {
+                    stats->colliding_pairs += chain_length * ( chain_length - 1 ) / 2;
+                }
+            stats->chain_lengths[ chain_length < HT_CHAIN_HISTOGRAM_SIZE - 1
+                                  ? chain_length : HT_CHAIN_HISTOGRAM_SIZE - 1 ]++;
+            if( chain_length > stats->longest_chain )
+                {
+                    stats->longest_chain = chain_length;
+                }
+        }
+
+    if( table->size > 1 )
+        {
+            stats->expected_pairs = (double) table->size * ( table->size - 1 )
+                                    / ( 2.0 * table->capacity );
+        }
+}
+
+void ht_stats_add( ht_stats_t* total, const ht_stats_t* add )
+{
+    int index;
+
+    total->tables          += add->tables;
+    total->entries         += add->entries;
+    total->buckets         += add->buckets;
+    total->empty_buckets   += add->empty_buckets;
+    total->probes          += add->probes;
+    total->colliding_pairs += add->colliding_pairs;
+    total->expected_pairs  += add->expected_pairs;
+    total->bytes           += add->bytes;
+
+    for( index = 0; index < HT_CHAIN_HISTOGRAM_SIZE; index++ )
+        {
+            total->chain_lengths[ index ] += add->chain_lengths[ index ];
+        }
+    if( add->longest_chain > total->longest_chain )
+        {
+            total->longest_chain = add->longest_chain;
+        }
+}
@@ -4,6 +4,9 @@
 #include <stdint.h>
 #define ITEM_NOT_FOUND -1
 
+// chains of HT_CHAIN_HISTOGRAM_SIZE - 1 or more entries share the last bucket
+#define HT_CHAIN_HISTOGRAM_SIZE 9
+
 typedef struct HT_Entry
 {
     char* key;
@@ -17,8 +20,44 @@ typedef struct hash_table_t
     HT_Entry** table_data; 
     uint32_t size;
     uint32_t capacity;
+
+    // length of every key of a kmer table, whose keys are hashed
+    // by their packed residue codes. 0 for any string keys
+    int key_length;
 } hash_table_t;
 
+/**
+ * Occupancy of one or more hash tables
+ * Note: Fields are sums, so the statistics of several tables can be
+ *       added with ht_stats_add. Ratios are left to the reader:
+ *       load factor is entries / buckets, mean successful probe length
+ *       is probes / entries, and colliding_pairs / expected_pairs is
+ *       near 1 when generate_hash spreads keys as a uniform random
+ *       hash would, larger when it clusters them
+ **/
+typedef struct ht_stats_t
+{
+    uint64_t tables;
+    uint64_t entries;
+    uint64_t buckets;
+    uint64_t empty_buckets;
+
+    // buckets holding a chain of each length
+    uint64_t chain_lengths[ HT_CHAIN_HISTOGRAM_SIZE ];
+    uint64_t longest_chain;
+
+    // nodes visited finding every entry once
+    uint64_t probes;
+
+    // pairs of entries sharing a bucket, and the number a uniform
+    // random hash would give for the same entries and buckets
+    uint64_t colliding_pairs;
+    double expected_pairs;
+
+    // buckets, entries and keys, without allocator overhead
+    uint64_t bytes;
+} ht_stats_t;
+
 
 /**
  * Initializes a HastTable struct. Allocates memory
@@ -28,12 +67,34 @@ typedef struct hash_table_t
  **/
 void ht_init( hash_table_t* table, int size );
 
+/**
+ * Initializes a hash_table_t whose keys are all kmers of one length
+ * Note: Keys are hashed from their residue codes, packed
+ *       MAX_PACKED_KMER_LENGTH at a time, with no strlen and no
+ *       unaligned loads. Every key added or looked up must be
+ *       key_length characters long
+ * @param table pointer to hash_table_t to init
+ * @param size integer size of hash_table_t
+ * @param key_length length of every key of the table
+ **/
+void ht_init_kmers( hash_table_t* table, int size, int key_length );
+
 /**
  * Clears a hash_table_t struct. Frees the memory
  * allocated for each HT_entry
  * @param table hash_table_t object to free
  **/
 void ht_clear( hash_table_t* table ); 
+
+/**
+ * Empties a hash_table_t struct, freeing each HT_Entry and its key,
+ * but keeps the table's buckets so it can be refilled without
+ * reallocating
+ * Note: Values are not freed
+ * @param table hash_table_t object to empty
+ **/
+void ht_reset( hash_table_t* table );
+
 /**
  * Generates the hash for use by the table.
  * @param input string to calculate hash for 
@@ -41,6 +102,14 @@ void ht_clear( hash_table_t* table );
  **/
 uint32_t generate_hash( const void *key,  int len, uint32_t seed );
 
+/**
+ * Generates the hash of a kmer from its packed residue codes
+ * @param key kmer to hash, at least key_length characters long
+ * @param key_length number of characters of key to hash
+ * @return integer value representing hash of the kmer
+ **/
+uint32_t generate_kmer_hash( const char *key, int key_length );
+
 /**
  * Adds an entry to the hashtable
  * Note: Uses linked list to resolve collisions
@@ -78,6 +147,8 @@ void *ht_find( hash_table_t* table, char* in_key );
 /**
  * Removes and frees data found in a hash table
  * Note: Uses find_item
+ * Note: Frees the table's copy of the key, the value is returned
+ *       for the caller to free
  * @param table pointer to hash_table_t to delete from
  * @param in_key String key value to search
  * @returns pointer to value of node that was deleted
@@ -91,5 +162,19 @@ void* ht_delete( hash_table_t* table, char* in_key );
  **/ 
 HT_Entry **ht_get_items( hash_table_t* input );
 HT_Entry *ht_get_items_no_malloc( hash_table_t* input, HT_Entry *data );
+
+/**
+ * Measures the occupancy of a hash table by walking every bucket
+ * @param table pointer to hash_table_t to measure
+ * @param stats pointer to ht_stats_t to store the statistics in
+ **/
+void ht_get_stats( hash_table_t* table, ht_stats_t* stats );
+
+/**
+ * Adds the statistics of one or more tables to a running total
+ * @param total pointer to ht_stats_t to add to
+ * @param add pointer to ht_stats_t to add
+ **/
+void ht_stats_add( ht_stats_t* total, const ht_stats_t* add );
 #endif
 
@@ -0,0 +1,290 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "id_set.h"
+
+#define DEFAULT_ID_CAPACITY 16
+
+// ids are stored in the interner's hash table offset by one,
+// so that a stored id of zero is not mistaken for a NULL value
+#define ID_TO_VALUE( id ) ( (void*) (uintptr_t) ( ( id ) + 1 ) )
+#define VALUE_TO_ID( value ) ( (uint32_t) ( (uintptr_t) ( value ) - 1 ) )
+
+static int compare_ids( const void* first, const void* second )
+{
+    uint32_t first_id  = *(const uint32_t*) first;
+    uint32_t second_id = *(const uint32_t*) second;
+
+    return ( first_id > second_id ) - ( first_id < second_id );
+}
+
+static void id_set_reserve( id_set_t* set, uint32_t capacity )
+{
+    uint32_t new_capacity = set->capacity ? set->capacity : DEFAULT_ID_CAPACITY;
+
+    if( capacity <= set->capacity )
+        {
+            return;
+        }
+
+    while( new_capacity < capacity )
+        {
+            new_capacity *= 2;
+        }
+
+    set->ids = realloc( set->ids, new_capacity * sizeof( uint32_t ) );
+    set->capacity = new_capacity;
+}
+
+// index of the first id in set that is not less than id
+static uint32_t id_set_lower_bound( const id_set_t* set, uint32_t id )
+{
+    uint32_t low  = 0;
+    uint32_t high = set->size;
+    uint32_t middle;
+
+    while( low < high )
+        {
+            middle = low + ( high - low ) / 2;
+            if( set->ids[ middle ] < id )
+                {
+                    low = middle + 1;
+                }
+            else
+                {
+                    high = middle;
+                }
+        }
+    return low;
+}
+
+void interner_init( string_interner_t* interner, unsigned int size )
+{
+    ht_init( &interner->ids, size );
+    ar_init( &interner->strings );
+}
+
+void interner_clear( string_interner_t* interner )
+{
+    ht_clear( &interner->ids );
+    ar_release( &interner->strings );
+}
+
+uint32_t intern( string_interner_t* interner, char* in_string )
+{
+    HT_Entry* found_item = find_item( &interner->ids, in_string );
+    uint32_t new_id = interner->strings.size;
+
+    if( found_item != NULL )
+        {
+            return VALUE_TO_ID( found_item->value );
+        }
+
+    ht_add( &interner->ids, in_string, ID_TO_VALUE( new_id ) );
+
+    // the table owns the copy of the string, point at it instead of copying again
+    ar_add( &interner->strings, find_item( &interner->ids, in_string )->key );
+    return new_id;
+}
+
+int interner_find( string_interner_t* interner, char* in_string, uint32_t* found_id )
+{
+    HT_Entry* found_item = find_item( &interner->ids, in_string );
+
+    if( found_item != NULL )
+        {
+            *found_id = VALUE_TO_ID( found_item->value );
+            return 1;
+        }
+    return 0;
+}
+
+char *interner_string( string_interner_t* interner, uint32_t id )
+{
+    return ar_get( &interner->strings, id );
+}
+
+void id_set_init( id_set_t* to_init, uint32_t capacity )
+{
+    to_init->size = 0;
+    to_init->capacity = 0;
+    to_init->ids = NULL;
+
+    id_set_reserve( to_init, capacity );
+}
+
+void id_set_clear( id_set_t* to_clear )
+{
+    free( to_clear->ids );
+    to_clear->ids = NULL;
+    to_clear->size = 0;
+    to_clear->capacity = 0;
+}
+
+void id_set_add( id_set_t* dest, uint32_t id )
+{
+    uint32_t insert_index = id_set_lower_bound( dest, id );
+
+    if( insert_index < dest->size && dest->ids[ insert_index ] == id )
+        {
+            return;
+        }
+
+    id_set_reserve( dest, dest->size + 1 );
+    memmove( dest->ids + insert_index + 1, dest->ids + insert_index,
+             ( dest->size - insert_index ) * sizeof( uint32_t )
+           );
+    dest->ids[ insert_index ] = id;
+    dest->size++;
+}
+
+void id_set_add_all( id_set_t* dest, const uint32_t* ids, uint32_t num_ids )
+{
+    uint32_t index;
+    uint32_t unique_size = 0;
+
+    if( num_ids == 0 )
+        {
+            return;
+        }
+
+    id_set_reserve( dest, dest->size + num_ids );
+    memcpy( dest->ids + dest->size, ids, num_ids * sizeof( uint32_t ) );
+    dest->size += num_ids;
+
+    qsort( dest->ids, dest->size, sizeof( uint32_t ), compare_ids );
+
+    for( index = 0; index < dest->size; index++ )
+        {
+            if( unique_size == 0 || dest->ids[ unique_size - 1 ] != dest->ids[ index ] )
+                {
+                    dest->ids[ unique_size++ ] = dest->ids[ index ];
+                }
+        }
+    dest->size = unique_size;
+}
+
+int id_set_check( const id_set_t* source, uint32_t id )
+{
+    uint32_t found_index = id_set_lower_bound( source, id );
+
+    return found_index < source->size && source->ids[ found_index ] == id;
+}
+
+void id_set_union( id_set_t* dest, const id_set_t* first, const id_set_t* second )
+{
+    uint32_t first_index  = 0;
+    uint32_t second_index = 0;
+    uint32_t out_index    = 0;
+
+    id_set_reserve( dest, first->size + second->size );
+
+    while( first_index < first->size && second_index < second->size )
+        {
+            if( first->ids[ first_index ] < second->ids[ second_index ] )
+                {
+                    dest->ids[ out_index++ ] = first->ids[ first_index++ ];
+                }
+            else if( second->ids[ second_index ] < first->ids[ first_index ] )
+                {
+                    dest->ids[ out_index++ ] = second->ids[ second_index++ ];
+                }
+            else
+                {
+                    dest->ids[ out_index++ ] = first->ids[ first_index++ ];
+                    second_index++;
+                }
+        }
+
+    while( first_index < first->size )
+        {
+            dest->ids[ out_index++ ] = first->ids[ first_index++ ];
+        }
+    while( second_index < second->size )
+        {
+            dest->ids[ out_index++ ] = second->ids[ second_index++ ];
+        }
+
+    dest->size = out_index;
+}
+
+void id_set_intersection( id_set_t* dest, const id_set_t* first, const id_set_t* second )
+{
+    uint32_t first_index  = 0;
+    uint32_t second_index = 0;
+    uint32_t out_index    = 0;
+
+    id_set_reserve( dest, first->size < second->size ? first->size : second->size );
+
+    while( first_index < first->size && second_index < second->size )
+        {
+            if( first->ids[ first_index ] < second->ids[ second_index ] )
+                {
+                    first_index++;
+                }
+            else if( second->ids[ second_index ] < first->ids[ first_index ] )
+                {
+                    second_index++;
+                }
+            else
+                {
+                    dest->ids[ out_index++ ] = first->ids[ first_index++ ];
+                    second_index++;
+                }
+        }
+
+    dest->size = out_index;
+}
+
+void id_set_difference( id_set_t* first, const id_set_t* second )
+{
+    uint32_t first_index  = 0;
+    uint32_t second_index = 0;
+    uint32_t out_index    = 0;
+
+    while( first_index < first->size )
+        {
+            while( second_index < second->size &&
+                   second->ids[ second_index ] < first->ids[ first_index ]
+                 )
+                {
+                    second_index++;
+                }
+
+            if( second_index == second->size ||
+                second->ids[ second_index ] != first->ids[ first_index ]
+              )
+                {
+                    first->ids[ out_index++ ] = first->ids[ first_index ];
+                }
+            first_index++;
+        }
+
+    first->size = out_index;
+}
+
+void id_set_add_strings( id_set_t* dest, set_t* source, string_interner_t* interner )
+{
+    HT_Entry** items = NULL;
+    uint32_t num_items = source->data->size;
+    uint32_t* ids = NULL;
+    uint32_t index;
+
+    if( num_items == 0 )
+        {
+            return;
+        }
+
+    items = set_get_items( source );
+    ids = malloc( num_items * sizeof( uint32_t ) );
+    for( index = 0; index < num_items; index++ )
+        {
+            ids[ index ] = intern( interner, items[ index ]->key );
+        }
+
+    id_set_add_all( dest, ids, num_items );
+
+    free( ids );
+    free( items );
+}
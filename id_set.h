@@ -0,0 +1,143 @@
+#ifndef ID_SET_H_INCLUDED
+#define ID_SET_H_INCLUDED
+
+#include <stdint.h>
+
+#include "hash_table.h"
+#include "array_list.h"
+#include "set.h"
+
+/**
+ * Assigns each distinct string a dense integer id, starting at zero,
+ * in the order the strings are first interned
+ **/
+typedef struct string_interner_t
+{
+    hash_table_t ids;
+    array_list_t strings;
+} string_interner_t;
+
+/**
+ * A set of integer ids, stored sorted and without duplicates so that
+ * bulk operations are linear merges
+ **/
+typedef struct id_set_t
+{
+    uint32_t size;
+    uint32_t capacity;
+    uint32_t *ids;
+} id_set_t;
+
+/**
+ * Initializes a string_interner_t
+ * @param interner pointer to string_interner_t to initialize
+ * @param size number of buckets for the interner's hash table
+ **/
+void interner_init( string_interner_t* interner, unsigned int size );
+
+/**
+ * Frees all of the memory held by an interner, including its strings
+ * @param interner pointer to string_interner_t to clear
+ **/
+void interner_clear( string_interner_t* interner );
+
+/**
+ * Gets the id of a string, assigning the next unused id if the
+ * string has not been interned before
+ * Note: the string is copied
+ * @param interner pointer to string_interner_t to intern with
+ * @param in_string string to intern
+ * @returns integer id of in_string
+ **/
+uint32_t intern( string_interner_t* interner, char* in_string );
+
+/**
+ * Looks up the id of a string without interning it
+ * @param interner pointer to string_interner_t to search
+ * @param in_string string to search for
+ * @param found_id pointer to store the id in, if found
+ * @returns integer boolean whether in_string had been interned
+ **/
+int interner_find( string_interner_t* interner, char* in_string, uint32_t* found_id );
+
+/**
+ * Gets the string an id was assigned to
+ * @param interner pointer to string_interner_t that assigned id
+ * @param id integer id to look up
+ * @returns the interned string, or NULL if id has not been assigned.
+ *          The string is owned by the interner.
+ **/
+char *interner_string( string_interner_t* interner, uint32_t id );
+
+/**
+ * Initializes an empty id_set_t
+ * @param to_init pointer to id_set_t to initialize
+ * @param capacity number of ids to reserve room for
+ **/
+void id_set_init( id_set_t* to_init, uint32_t capacity );
+
+/**
+ * Frees the ids held by a set, but not the set itself
+ * @param to_clear pointer to id_set_t to clear
+ **/
+void id_set_clear( id_set_t* to_clear );
+
+/**
+ * Adds a single id to a set
+ * Note: Shifts larger ids over, use id_set_add_all to add many ids
+ * @param dest pointer to id_set_t to add to
+ * @param id integer id to add
+ **/
+void id_set_add( id_set_t* dest, uint32_t id );
+
+/**
+ * Adds an unordered array of ids, which may contain duplicates, to a set
+ * @param dest pointer to id_set_t to add to
+ * @param ids array of ids to add
+ * @param num_ids number of ids in the array
+ **/
+void id_set_add_all( id_set_t* dest, const uint32_t* ids, uint32_t num_ids );
+
+/**
+ * Checks whether an id is a member of a set
+ * @param source pointer to id_set_t to search
+ * @param id integer id to search for
+ * @returns integer boolean result of search
+ **/
+int id_set_check( const id_set_t* source, uint32_t id );
+
+/**
+ * Computes the union of two sets
+ * Note: dest must not be first or second
+ * @param dest initialized set whose contents are replaced by the result
+ * @param first set to compute the union of
+ * @param second set to compute the union of
+ **/
+void id_set_union( id_set_t* dest, const id_set_t* first, const id_set_t* second );
+
+/**
+ * Computes the intersection of two sets
+ * Note: dest must not be first or second
+ * @param dest initialized set whose contents are replaced by the result
+ * @param first set to compute the intersection of
+ * @param second set to compute the intersection of
+ **/
+void id_set_intersection( id_set_t* dest, const id_set_t* first, const id_set_t* second );
+
+/**
+ * Computes the relative complement of sets first and second in place
+ * e.g. x an element of first where x is not an element of second
+ * @param first set to remove the elements of second from
+ * @param second set of elements to remove
+ **/
+void id_set_difference( id_set_t* first, const id_set_t* second );
+
+/**
+ * Adds every string of a set_t to an id set, interning the strings
+ * @param dest pointer to id_set_t to add to
+ * @param source pointer to set_t whose strings to add
+ * @param interner pointer to string_interner_t to intern strings with
+ **/
+void id_set_add_strings( id_set_t* dest, set_t* source, string_interner_t* interner );
+
+#endif
@@ -0,0 +1,143 @@
+#include <string.h>
+
+#include "kernels.h"
+
+// x86-64 builds carry an AVX2 and an AVX-512 copy of each kernel
+#if defined( __GNUC__ ) && defined( __x86_64__ )
+#define HAVE_KERNEL_LEVELS 1
+#endif
+
+typedef void (*count_mismatches_t)( const char *item_columns, unsigned int num_items,
+                                    const char *kmer, int window_size, uint8_t *mismatches
+                                  );
+
+static const char *LEVEL_NAMES[ NUM_CPU_LEVELS ] =
+{
+    "baseline",
+    "avx2",
+    "avx512"
+};
+
+// a column at a time, so the inner loop runs over items with no
+// branches and vectorizes to the widest registers of the level
+static inline __attribute__(( always_inline ))
+void count_mismatches_columns( const char *item_columns, unsigned int num_items,
+                               const char *kmer, int window_size, uint8_t *mismatches
+                             )
+{
+    const char *column = NULL;
+    char residue = 0;
+    unsigned int index = 0;
+    int position = 0;
+
+    memset( mismatches, 0, num_items );
+    for( position = 0; position < window_size; position++ )
+        {
+            column  = item_columns + (size_t) position * num_items;
+            residue = kmer[ position ];
+            for( index = 0; index < num_items; index++ )
+                {
+                    mismatches[ index ] += column[ index ] != residue;
+                }
+        }
+}
+
+static void count_mismatches_baseline( const char *item_columns, unsigned int num_items,
+                                       const char *kmer, int window_size, uint8_t *mismatches
+                                     )
+{
+    count_mismatches_columns( item_columns, num_items, kmer, window_size, mismatches );
+}
+
+#ifdef HAVE_KERNEL_LEVELS
+__attribute__(( target( "avx2" ) ))
+static void count_mismatches_avx2( const char *item_columns, unsigned int num_items,
+                                   const char *kmer, int window_size, uint8_t *mismatches
+                                 )
+{
+    count_mismatches_columns( item_columns, num_items, kmer, window_size, mismatches );
+}
+
+__attribute__(( target( "avx512f,avx512bw" ) ))
+static void count_mismatches_avx512( const char *item_columns, unsigned int num_items,
+                                     const char *kmer, int window_size, uint8_t *mismatches
+                                   )
+{
+    count_mismatches_columns( item_columns, num_items, kmer, window_size, mismatches );
+}
+#endif
+
+static const count_mismatches_t COUNT_MISMATCHES[ NUM_CPU_LEVELS ] =
+{
+    count_mismatches_baseline,
+#ifdef HAVE_KERNEL_LEVELS
+    count_mismatches_avx2,
+    count_mismatches_avx512
+#else
+    count_mismatches_baseline,
+    count_mismatches_baseline
+#endif
+};
+
+static cpu_level_t selected_level = CPU_LEVEL_BASELINE;
+
+cpu_level_t cpu_detect_level( void )
+{
+#ifdef HAVE_KERNEL_LEVELS
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports( "avx512f" ) && __builtin_cpu_supports( "avx512bw" ) )
+        {
+            return CPU_LEVEL_AVX512;
+        }
+    if( __builtin_cpu_supports( "avx2" ) )
+        {
+            return CPU_LEVEL_AVX2;
+        }
+#endif
+    return CPU_LEVEL_BASELINE;
+}
+
+const char *cpu_level_name( cpu_level_t level )
+{
+    return LEVEL_NAMES[ level ];
+}
+
+bool cpu_parse_level( const char *name, cpu_level_t *level )
+{
+    int index = 0;
+
+    if( !strcmp( name, "auto" ) )
+        {
+            *level = cpu_detect_level();
+            return true;
+        }
+    for( index = 0; index < NUM_CPU_LEVELS; index++ )
+        {
+            if( !strcmp( name, LEVEL_NAMES[ index ] ) )
+                {
+                    *level = index;
+                    return true;
+                }
+        }
+    return false;
+}
+
+cpu_level_t kernels_init( cpu_level_t level )
+{
+    cpu_level_t detected = cpu_detect_level();
+
+    selected_level = level > detected ? detected : level;
+    return selected_level;
+}
+
+cpu_level_t kernels_level( void )
+{
+    return selected_level;
+}
+
+void count_mismatches( const char *item_columns, unsigned int num_items,
+                       const char *kmer, int window_size, uint8_t *mismatches
+                     )
+{
+    COUNT_MISMATCHES[ selected_level ]( item_columns, num_items, kmer, window_size, mismatches );
+}
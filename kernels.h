@@ -0,0 +1,73 @@
+#ifndef KERNELS_H_INCLUDED
+#define KERNELS_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Instruction set levels the hot kernels are built for
+ * Note: All levels are built into the same binary, kernels_init picks
+ *       one at startup. Levels above baseline exist on x86-64 only
+ **/
+typedef enum cpu_level
+{
+    CPU_LEVEL_BASELINE,
+    CPU_LEVEL_AVX2,
+    CPU_LEVEL_AVX512,
+    NUM_CPU_LEVELS
+} cpu_level_t;
+
+// longest kmer count_mismatches can count the mismatches of
+#define MAX_KERNEL_WINDOW_SIZE 255
+
+/**
+ * Gets the highest level the running cpu supports
+ * @returns cpu_level_t level detected with cpuid
+ **/
+cpu_level_t cpu_detect_level( void );
+
+/**
+ * Gets the name of a level
+ * @param level cpu_level_t level to name
+ * @returns string name of the level
+ **/
+const char *cpu_level_name( cpu_level_t level );
+
+/**
+ * Looks up a level by name
+ * @param name string name of the level, "auto" for the detected level
+ * @param level pointer to cpu_level_t to store the level in
+ * @returns boolean true if name is a level
+ **/
+bool cpu_parse_level( const char *name, cpu_level_t *level );
+
+/**
+ * Selects the kernels of one level for the rest of the run
+ * Note: A level the cpu does not support is lowered to the detected
+ *       level. Until this is called the baseline kernels are used
+ * @param level cpu_level_t level to use
+ * @returns the level selected
+ **/
+cpu_level_t kernels_init( cpu_level_t level );
+
+/**
+ * Gets the level of the selected kernels
+ * @returns cpu_level_t level in use
+ **/
+cpu_level_t kernels_level( void );
+
+/**
+ * Counts the positions at which each item differs from kmer
+ * Note: Items are stored by position, item i holds
+ *       item_columns[ p * num_items + i ] at position p
+ * @param item_columns window_size columns of num_items characters
+ * @param num_items number of items in each column
+ * @param kmer string of window_size characters to compare with
+ * @param window_size kmer length, at most MAX_KERNEL_WINDOW_SIZE
+ * @param mismatches array of num_items counts to fill
+ **/
+void count_mismatches( const char *item_columns, unsigned int num_items,
+                       const char *kmer, int window_size, uint8_t *mismatches
+                     );
+
+#endif
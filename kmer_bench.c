@@ -0,0 +1,385 @@
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "kmer_counts.h"
+#include "synthetic.h"
+#include "kernels.h"
+
+// most scales and thread counts one run accepts
+#define MAX_BENCH_RUNS 16
+
+// stages of the pipeline that are timed, in pipeline order
+typedef enum bench_stage
+{
+    BENCH_READ,
+    BENCH_BUILD_TABLE,
+    BENCH_COUNT,
+    BENCH_WRITE,
+    NUM_BENCH_STAGES
+} bench_stage_t;
+
+// a workload size, design_proteins of the reference proteins are tiled
+typedef struct bench_scale
+{
+    const char *name;
+    unsigned int num_proteins;
+    unsigned int design_proteins;
+} bench_scale_t;
+
+// best time of each stage at one thread count, and the work it did
+typedef struct bench_result
+{
+    double seconds[ NUM_BENCH_STAGES ];
+    double work[ NUM_BENCH_STAGES ];
+} bench_result_t;
+
+static const bench_scale_t SCALES[] =
+{
+    { "small",  40,  4 },
+    { "medium", 160, 16 },
+    { "large",  640, 32 }
+};
+#define NUM_SCALES ( sizeof( SCALES ) / sizeof( SCALES[ 0 ] ) )
+
+static const char *STAGE_NAMES[ NUM_BENCH_STAGES ] =
+{
+    "read", "build_table", "count", "write"
+};
+
+// unit of each stage's throughput, in millions per second
+static const char *STAGE_UNITS[ NUM_BENCH_STAGES ] =
+{
+    "MB/s", "Mkmers/s", "Mcompares/s", "Mrows/s"
+};
+
+static const struct option LONG_OPTIONS[] =
+{
+    { "scales",     required_argument, NULL, 's' },
+    { "threads",    required_argument, NULL, 't' },
+    { "dir",        required_argument, NULL, 'd' },
+    { "repeats",    required_argument, NULL, 'n' },
+    { "redundancy", required_argument, NULL, 'r' },
+    { "x-fraction", required_argument, NULL, 'x' },
+    { "seed",       required_argument, NULL, 'S' },
+    { "window-size", required_argument, NULL, 'k' },
+    { "isa",        required_argument, NULL, 'I' },
+    { NULL, 0, NULL, 0 }
+};
+
+static bool write_workload( const bench_scale_t *scale, const synthetic_params_t *synthetic,
+                            const char *ref_file_name, const char *design_file_name
+                          );
+static void run_pipeline( char *ref_file_name, char *design_file_name, char *out_file_name,
+                          int window_size, bench_result_t *result
+                        );
+static void print_results( const bench_scale_t *scale, const int *thread_counts,
+                           int num_thread_counts, const bench_result_t *results
+                         );
+
+int main( int argc, char **argv )
+{
+    synthetic_params_t synthetic;
+    const bench_scale_t *scales[ MAX_BENCH_RUNS ];
+    int thread_counts[ MAX_BENCH_RUNS ];
+    int num_scales = 0;
+    int num_thread_counts = 0;
+    bench_result_t results[ MAX_BENCH_RUNS ];
+    bench_result_t run;
+
+    char scale_list[] = "small,medium";
+    char thread_list[] = "1,2,4";
+    char *scale_arg = scale_list;
+    char *thread_arg = thread_list;
+    char *token = NULL;
+    char *dir = "/tmp";
+    int repeats = 3;
+    int window_size = WINDOW_SIZE;
+    cpu_level_t isa_level = cpu_detect_level();
+
+    char ref_file_name[ MAX_STRING_SIZE ];
+    char design_file_name[ MAX_STRING_SIZE ];
+    char out_file_name[ MAX_STRING_SIZE ];
+
+    int option = 0;
+    int index = 0;
+    int thread_index = 0;
+    int repeat = 0;
+    int stage = 0;
+    unsigned int scale_index = 0;
+
+    synthetic_init( &synthetic );
+
+    while( ( option = getopt_long( argc, argv, "s:t:d:n:r:x:S:k:I:", LONG_OPTIONS, NULL ) ) != -1 )
+        {
+            switch( option )
+                {
+                case 's':
+                    scale_arg = optarg;
+                    break;
+                case 't':
+                    thread_arg = optarg;
+                    break;
+                case 'd':
+                    dir = optarg;
+                    break;
+                case 'n':
+                    repeats = atoi( optarg );
+                    break;
+                case 'r':
+                    synthetic.redundancy = atof( optarg );
+                    break;
+                case 'x':
+                    synthetic.x_fraction = atof( optarg );
+                    break;
+                case 'S':
+                    synthetic.seed = strtoull( optarg, NULL, 10 );
+                    break;
+                case 'k':
+                    window_size = atoi( optarg );
+                    break;
+                case 'I':
+                    if( !cpu_parse_level( optarg, &isa_level ) )
+                        {
+                            printf( "Invalid instruction set %s\n", optarg );
+                            return EXIT_FAILURE;
+                        }
+                    break;
+                default:
+                    printf( "USAGE: kmer_bench [-s small,medium,large] [-t threads[,threads...]] "
+                            "[-d dir] [-n repeats] [-r redundancy] [-x x_fraction] [-S seed] "
+                            "[-k window_size] [--isa auto|baseline|avx2|avx512]\n"
+                          );
+                    return EXIT_FAILURE;
+                }
+        }
+
+    for( token = strtok( scale_arg, "," ); token; token = strtok( NULL, "," ) )
+        {
+            for( scale_index = 0; scale_index < NUM_SCALES; scale_index++ )
+                {
+                    if( !strcmp( token, SCALES[ scale_index ].name ) )
+                        {
+                            break;
+                        }
+                }
+            if( scale_index == NUM_SCALES || num_scales == MAX_BENCH_RUNS )
+                {
+                    printf( "Invalid scale %s\n", token );
+                    return EXIT_FAILURE;
+                }
+            scales[ num_scales++ ] = &SCALES[ scale_index ];
+        }
+
+    for( token = strtok( thread_arg, "," ); token; token = strtok( NULL, "," ) )
+        {
+            if( atoi( token ) < 1 || num_thread_counts == MAX_BENCH_RUNS )
+                {
+                    printf( "Invalid thread count %s\n", token );
+                    return EXIT_FAILURE;
+                }
+            thread_counts[ num_thread_counts++ ] = atoi( token );
+        }
+
+    if( repeats < 1 || window_size < 1 || window_size > (int) synthetic.oligo_length )
+        {
+            printf( "Invalid repeats or window size\n" );
+            return EXIT_FAILURE;
+        }
+
+    printf( "Using %s kernels, the cpu supports %s\n", cpu_level_name( kernels_init( isa_level ) ),
+            cpu_level_name( cpu_detect_level() )
+          );
+
+    #ifndef _OPENMP
+    printf( "Built without OpenMP, every thread count runs on one thread. "
+            "Use make bench for parallel results\n"
+          );
+    #endif
+
+    for( index = 0; index < num_scales; index++ )
+        {
+            snprintf( ref_file_name, MAX_STRING_SIZE, "%s/kmer_bench_%s_reference.fasta",
+                      dir, scales[ index ]->name
+                    );
+            snprintf( design_file_name, MAX_STRING_SIZE, "%s/kmer_bench_%s_design.fasta",
+                      dir, scales[ index ]->name
+                    );
+            snprintf( out_file_name, MAX_STRING_SIZE, "%s/kmer_bench_%s_out.tsv",
+                      dir, scales[ index ]->name
+                    );
+            if( !write_workload( scales[ index ], &synthetic, ref_file_name, design_file_name ) )
+                {
+                    printf( "Unable to write the %s workload to %s\n", scales[ index ]->name, dir );
+                    return EXIT_FAILURE;
+                }
+
+            for( thread_index = 0; thread_index < num_thread_counts; thread_index++ )
+                {
+                    #ifdef _OPENMP
+                    omp_set_num_threads( thread_counts[ thread_index ] );
+                    #endif
+
+                    // the fastest of the repeats, each stage separately
+                    for( repeat = 0; repeat < repeats; repeat++ )
+                        {
+                            run_pipeline( ref_file_name, design_file_name, out_file_name,
+                                          window_size, &run
+                                        );
+                            for( stage = 0; stage < NUM_BENCH_STAGES; stage++ )
+                                {
+                                    if( !repeat
+                                        || run.seconds[ stage ] < results[ thread_index ].seconds[ stage ]
+                                      )
+                                        {
+                                            results[ thread_index ].seconds[ stage ] = run.seconds[ stage ];
+                                        }
+                                    results[ thread_index ].work[ stage ] = run.work[ stage ];
+                                }
+                        }
+                }
+
+            print_results( scales[ index ], thread_counts, num_thread_counts, results );
+        }
+
+    return EXIT_SUCCESS;
+}
+
+static bool write_workload( const bench_scale_t *scale, const synthetic_params_t *synthetic,
+                            const char *ref_file_name, const char *design_file_name
+                          )
+{
+    synthetic_params_t params = *synthetic;
+    sequence_t **proteome = NULL;
+    sequence_t **oligos = NULL;
+    int num_oligos = 0;
+    FILE *test_file = NULL;
+
+    // write_fastas does not report a file it cannot open
+    test_file = fopen( ref_file_name, "w" );
+    if( !test_file )
+        {
+            return false;
+        }
+    fclose( test_file );
+
+    params.num_proteins = scale->num_proteins;
+    proteome = synthetic_proteome( &params );
+    oligos = synthetic_library( proteome, scale->design_proteins, &params, &num_oligos );
+
+    write_fastas( proteome, params.num_proteins, (char *) ref_file_name );
+    write_fastas( oligos, num_oligos, (char *) design_file_name );
+
+    clear_seqs( proteome, params.num_proteins );
+    clear_seqs( oligos, num_oligos );
+    free( proteome );
+    free( oligos );
+
+    return true;
+}
+
+static void run_pipeline( char *ref_file_name, char *design_file_name, char *out_file_name,
+                          int window_size, bench_result_t *result
+                        )
+{
+    run_stats_t stats;
+    match_params_t params = { NUM_MISMATCHES, NULL, false, window_size, &stats, NULL, NULL };
+    sequence_t **refseqs = NULL;
+    sequence_t **oligos = NULL;
+    hash_table_t **tables = NULL;
+    HT_Entry **items = NULL;
+    FILE *open_file = NULL;
+    int num_refs = 0;
+    int num_oligos = 0;
+    unsigned int num_items = 0;
+    double start = 0;
+
+    stats_init( &stats );
+
+    start = stats_time();
+    open_file = fopen( ref_file_name, "r" );
+    num_refs = count_seqs_in_file( open_file );
+    fclose( open_file );
+    open_file = fopen( design_file_name, "r" );
+    num_oligos = count_seqs_in_file( open_file );
+    fclose( open_file );
+    refseqs = count_and_read_seqs( ref_file_name );
+    oligos = count_and_read_seqs( design_file_name );
+    result->seconds[ BENCH_READ ] = stats_time() - start;
+    result->work[ BENCH_READ ] = stats_file_size( ref_file_name ) + stats_file_size( design_file_name );
+
+    start = stats_time();
+    tables = seqs_to_kmer_tables( refseqs, num_refs, &window_size, 1, &stats );
+    result->seconds[ BENCH_BUILD_TABLE ] = stats_time() - start;
+    result->work[ BENCH_BUILD_TABLE ] = stats.kmers_extracted;
+
+    start = stats_time();
+    get_kmer_totals( tables[ 0 ], oligos, NULL, num_oligos, 1, &params );
+    result->seconds[ BENCH_COUNT ] = stats_time() - start;
+    result->work[ BENCH_COUNT ] = stats.comparisons;
+
+    start = stats_time();
+    num_items = tables[ 0 ]->size;
+    items = ht_get_items( tables[ 0 ] );
+    write_outputs( out_file_name, items, num_items, 1 );
+    result->seconds[ BENCH_WRITE ] = stats_time() - start;
+    result->work[ BENCH_WRITE ] = num_items;
+
+    free( items );
+    clear_table( tables[ 0 ] );
+    free( tables );
+    clear_seqs( refseqs, num_refs );
+    clear_seqs( oligos, num_oligos );
+    free( refseqs );
+    free( oligos );
+}
+
+static void print_results( const bench_scale_t *scale, const int *thread_counts,
+                           int num_thread_counts, const bench_result_t *results
+                         )
+{
+    double total = 0;
+    double base_total = 0;
+    double seconds = 0;
+    double base = 0;
+    int thread_index = 0;
+    int stage = 0;
+
+    printf( "\n%s: %u proteins, %u tiled\n", scale->name, scale->num_proteins,
+            scale->design_proteins
+          );
+    printf( "%-8s %-12s %12s %14s %-12s %10s\n", "threads", "stage", "seconds",
+            "throughput", "", "efficiency"
+          );
+
+    // efficiency is against the first thread count, T1 / ( p * Tp ) when that is 1
+    for( stage = 0; stage < NUM_BENCH_STAGES; stage++ )
+        {
+            base_total += results[ 0 ].seconds[ stage ];
+        }
+    for( thread_index = 0; thread_index < num_thread_counts; thread_index++ )
+        {
+            total = 0;
+            for( stage = 0; stage < NUM_BENCH_STAGES; stage++ )
+                {
+                    seconds = results[ thread_index ].seconds[ stage ];
+                    base = results[ 0 ].seconds[ stage ];
+                    total += seconds;
+                    printf( "%-8d %-12s %12.6f %14.3f %-12s %10.2f\n",
+                            thread_counts[ thread_index ], STAGE_NAMES[ stage ], seconds,
+                            seconds > 0 ? results[ thread_index ].work[ stage ] / seconds / 1e6 : 0,
+                            STAGE_UNITS[ stage ],
+                            seconds > 0 ? base * thread_counts[ 0 ]
+                                          / ( seconds * thread_counts[ thread_index ] ) : 0
+                          );
+                }
+            printf( "%-8d %-12s %12.6f %14s %-12s %10.2f\n", thread_counts[ thread_index ],
+                    "total", total, "", "",
+                    total > 0 ? base_total * thread_counts[ 0 ]
+                                / ( total * thread_counts[ thread_index ] ) : 0
+                  );
+        }
+}
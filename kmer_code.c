@@ -0,0 +1,51 @@
+#include "kmer_code.h"
+
+#define STAR_CODE 27
+
+const uint8_t residue_codes[ 256 ] =
+{
+    [ '*' ] = STAR_CODE,
+    [ 'A' ] = 1,  [ 'B' ] = 2,  [ 'C' ] = 3,  [ 'D' ] = 4,  [ 'E' ] = 5,
+    [ 'F' ] = 6,  [ 'G' ] = 7,  [ 'H' ] = 8,  [ 'I' ] = 9,  [ 'J' ] = 10,
+    [ 'K' ] = 11, [ 'L' ] = 12, [ 'M' ] = 13, [ 'N' ] = 14, [ 'O' ] = 15,
+    [ 'P' ] = 16, [ 'Q' ] = 17, [ 'R' ] = 18, [ 'S' ] = 19, [ 'T' ] = 20,
+    [ 'U' ] = 21, [ 'V' ] = 22, [ 'W' ] = 23, [ 'X' ] = 24, [ 'Y' ] = 25,
+    [ 'Z' ] = 26
+};
+
+char code_to_residue( uint8_t code )
+{
+    if( code == STAR_CODE )
+        {
+            return '*';
+        }
+    if( code >= 1 && code <= 26 )
+        {
+            return 'A' + code - 1;
+        }
+    return '\0';
+}
+
+kmer_code_t kmer_pack( const char *kmer, int length )
+{
+    kmer_code_t code = 0;
+    int index;
+
+    for( index = 0; index < length; index++ )
+        {
+            code = ( code << RESIDUE_BITS ) | residue_to_code( kmer[ index ] );
+        }
+    return code;
+}
+
+void kmer_unpack( kmer_code_t code, int length, char *dest )
+{
+    int index;
+
+    for( index = length - 1; index >= 0; index-- )
+        {
+            dest[ index ] = code_to_residue( code & RESIDUE_MASK );
+            code >>= RESIDUE_BITS;
+        }
+    dest[ length ] = '\0';
+}
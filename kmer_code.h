@@ -0,0 +1,56 @@
+#ifndef KMER_CODE_H_INCLUDED
+#define KMER_CODE_H_INCLUDED
+
+#include <stdint.h>
+
+#define RESIDUE_BITS 5
+#define RESIDUE_MASK 0x1F
+#define NUM_RESIDUE_CODES 32
+#define MAX_PACKED_KMER_LENGTH 12
+#define INVALID_RESIDUE_CODE 0
+
+typedef uint64_t kmer_code_t;
+
+/**
+ * Maps every byte to its residue code. 'A' through 'Z' map to 1 through 26,
+ * '*' maps to 27, and every other character maps to INVALID_RESIDUE_CODE.
+ **/
+extern const uint8_t residue_codes[ 256 ];
+
+/**
+ * Gets the residue code of an amino acid character
+ * @param residue character to encode
+ * @returns integer code in [0, NUM_RESIDUE_CODES)
+ **/
+static inline uint8_t residue_to_code( char residue )
+{
+    return residue_codes[ (unsigned char) residue ];
+}
+
+/**
+ * Gets the amino acid character represented by a residue code
+ * @param code residue code to decode
+ * @returns character represented by code, or '\0' if code is invalid
+ **/
+char code_to_residue( uint8_t code );
+
+/**
+ * Packs a kmer into an integer, RESIDUE_BITS bits per residue with
+ * the first residue in the most significant position
+ * Note: length must be no more than MAX_PACKED_KMER_LENGTH
+ * @param kmer string kmer to pack
+ * @param length number of characters of kmer to pack
+ * @returns packed representation of kmer
+ **/
+kmer_code_t kmer_pack( const char *kmer, int length );
+
+/**
+ * Unpacks a kmer packed by kmer_pack
+ * @param code packed kmer
+ * @param length number of residues packed in code
+ * @param dest character array of at least length + 1 bytes to write
+ *        the NUL-terminated kmer to
+ **/
+void kmer_unpack( kmer_code_t code, int length, char *dest );
+
+#endif
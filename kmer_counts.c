@@ -0,0 +1,1513 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kmer_counts.h"
+#include "array_list.h"
+#include "kmer_code.h"
+#include "kmer_results.h"
+#include "kernels.h"
+
+const int WINDOW_SIZE      = 9;
+const int NUM_MISMATCHES   = 1;
+const int MAX_STRING_SIZE  = 512;
+const int LARGE_TABLE_SIZE = 4000000;
+
+#define OUTPUT_BUFFER_SIZE ( 1 << 20 )
+// fewest rows per thread worth sorting in parallel
+#define MIN_SORT_CHUNK 4096
+// longest row write_outputs formats: a kmer of up to MAX_STRING_SIZE
+// characters, num_scores scores, a start and an end of up to 10 digits,
+// their tabs and a newline
+#define MAX_OUTPUT_ROW_SIZE( num_scores ) \
+    ( 512 + ( ( num_scores ) + 2 ) * 10 + ( num_scores ) + 3 )
+
+typedef struct item_heap
+{
+    HT_Entry **items;
+    unsigned int size;
+    unsigned int capacity;
+} item_heap_t;
+
+static inline bool tolerable_match( char *a, char *b, int size, int num_mismatches );
+static inline void add_valid_kmers( kmer_t **kmers, const unsigned int num_subsets, hash_table_t *table );
+static inline void add_item_score( item_scores_t *scores, unsigned int index,
+                                   unsigned int library, unsigned int amount
+                                 );
+static void substring_indices( char *src, char *dest, const int start, const int end );
+static inline int num_substrings( const int str_len, const int window_size );
+static void subset_lists_ht( hash_table_t *dest, char *seq,
+                              int sequence_len, const int window_size );
+static uint8_t *encode_items( HT_Entry **items, unsigned int num_items, int window_size );
+static char *item_columns( HT_Entry **items, unsigned int num_items, int window_size );
+static unsigned int get_column_mismatch_counts( item_scores_t *scores,
+                                                const char *columns, char *kmer,
+                                                unsigned int num_items, int num_mismatches,
+                                                unsigned int library, uint8_t *mismatches
+                                              );
+static hash_table_t *reduced_kmer_index( hash_table_t *target_kmers, int window_size );
+static void clear_reduced_index( hash_table_t *index );
+
+void get_kmer_totals( hash_table_t *target_kmers,
+                      sequence_t **designed_oligos,
+                      const unsigned int *libraries, int num_oligos,
+                      unsigned int num_libraries, const match_params_t *params
+                    )
+{
+    hash_table_t *target_ptr   = target_kmers;
+    HT_Entry **items           = NULL;
+    hash_table_t *subset_kmers = NULL;
+    char       *current_oligo  = NULL;
+    uint8_t    *item_codes     = NULL;
+    char       *columns        = NULL;
+
+
+    unsigned int index = 0;
+    
+    items = ht_get_items( target_ptr );
+
+    if( params->blosum_data )
+        {
+            item_codes = encode_items( items, target_ptr->size, params->window_size );
+        }
+    else if( target_ptr->size && params->window_size <= MAX_KERNEL_WINDOW_SIZE )
+        {
+            columns = item_columns( items, target_ptr->size, params->window_size );
+        }
+
+    #pragma omp parallel shared( target_ptr, items, designed_oligos ) \
+            private( index, current_oligo, subset_kmers )
+    {
+        int oligo_size = 0;
+        int num_subsets = 0;
+        unsigned int library = 0;
+
+        unsigned int inner_index = 0;
+
+        HT_Entry **subset_items = NULL;
+
+        // this thread's counts, added to the targets' running scores below
+        item_scores_t scores;
+
+        // mismatches of every target with the current design kmer
+        uint8_t *mismatches = columns ? malloc( target_ptr->size ) : NULL;
+
+        // added to the run's counters once, in the merge below
+        uint64_t kmers_extracted = 0;
+        uint64_t comparisons     = 0;
+        uint64_t matches         = 0;
+        ht_stats_t oligo_tables;
+        ht_stats_t oligo_table;
+        double merge_start       = 0;
+        double span_start        = stats_time();
+        double match_start       = 0;
+        double match_end         = 0;
+        int thread               = omp_get_thread_num();
+
+        // this thread's hardware counts at the start and end of matching
+        // and merging, all zero without --perf-counters
+        uint64_t match_counts[ NUM_PERF_EVENTS ];
+        uint64_t match_end_counts[ NUM_PERF_EVENTS ];
+        uint64_t merge_counts[ NUM_PERF_EVENTS ];
+        uint64_t merge_end_counts[ NUM_PERF_EVENTS ];
+
+        memset( &oligo_tables, 0, sizeof( oligo_tables ) );
+        subset_kmers = malloc( sizeof( hash_table_t ) );
+
+        item_scores_init( &scores, target_ptr->size, num_libraries );
+        trace_record( params->trace, thread, "zero scores", span_start, stats_time() );
+        perf_counters_read_thread( params->perf, thread, match_counts );
+        match_start = stats_time();
+
+        // each thread merges as soon as its own oligos are counted, the
+        // merge below does not depend on other threads' counts
+        #pragma omp for nowait
+        for( index = 0; index < (unsigned int) num_oligos; index++ )
+            {
+                // libraries may hold oligos of different lengths
+                oligo_size  = designed_oligos[ index ]->sequence->size;
+                num_subsets = num_substrings( oligo_size, params->window_size );
+                library     = libraries ? libraries[ index ] : 0;
+
+                ht_init_kmers( subset_kmers, num_subsets > 0 ? num_subsets : 1, params->window_size );
+                current_oligo = designed_oligos[ index ]->sequence->data;
+
+                subset_lists_ht( subset_kmers, current_oligo,
+                                 oligo_size, params->window_size
+                               );
+
+                if( params->stats->oligo_table_stats )
+                    {
+                        ht_get_stats( subset_kmers, &oligo_table );
+                        ht_stats_add( &oligo_tables, &oligo_table );
+                    }
+
+                subset_items = ht_get_items( subset_kmers );
+                kmers_extracted += num_subsets > 0 ? num_subsets : 0;
+                comparisons     += (uint64_t) subset_kmers->size * target_ptr->size;
+
+                for( inner_index = 0; inner_index < subset_kmers->size; inner_index++ )
+                    {
+
+
+                        if( params->blosum_data )
+                            {
+                                matches += get_substitution_counts( &scores, item_codes,
+                                                         subset_items[ inner_index ]->key,
+                                                         target_ptr->size, params, library
+                                                       );
+                            }
+                        else if( columns )
+                            {
+                                matches += get_column_mismatch_counts( &scores, columns,
+                                                                       subset_items[ inner_index ]->key,
+                                                                       target_ptr->size,
+                                                                       params->num_mismatches,
+                                                                       library, mismatches
+                                                                     );
+                            }
+                        else
+                            {
+                                matches += get_mismatch_counts( &scores, items, subset_items[ inner_index ]->key,
+                                                     target_ptr->size, params->num_mismatches,
+                                                     library
+                                                   );
+                            }
+                        free( ( (kmer_t*)(subset_items[ inner_index ]->value) )->seq );
+                        free( subset_items[ inner_index ]->value );
+                    }
+                free( subset_items );
+                ht_clear( subset_kmers );
+            }
+
+        free( subset_kmers );
+        free( mismatches );
+        match_end = stats_time();
+        perf_counters_read_thread( params->perf, thread, match_end_counts );
+        trace_record( params->trace, thread, "design chunk", match_start, match_end );
+
+        span_start = stats_time();
+        #pragma omp critical
+        {
+            perf_counters_read_thread( params->perf, thread, merge_counts );
+            merge_start = stats_time();
+            trace_record( params->trace, thread, "merge wait", span_start, merge_start );
+            item_scores_add_to( &scores, items, target_ptr->size );
+
+            params->stats->kmers_extracted += kmers_extracted;
+            params->stats->comparisons     += comparisons;
+            params->stats->matches         += matches;
+            if( params->stats->oligo_table_stats )
+                {
+                    stats_add_table( params->stats, "oligo", params->window_size, &oligo_tables );
+                }
+            params->stats->stage_seconds[ STAGE_MATCH ] += match_end - match_start;
+            stats_add_perf( params->stats, STAGE_MATCH, match_counts, match_end_counts );
+
+            perf_counters_read_thread( params->perf, thread, merge_end_counts );
+            stats_add_perf( params->stats, STAGE_MERGE, merge_counts, merge_end_counts );
+            stats_add_time( params->stats, STAGE_MERGE, merge_start );
+            trace_record( params->trace, thread, "merge", merge_start, stats_time() );
+        }
+
+        item_scores_clear( &scores );
+    }
+
+    free( items );
+    free( item_codes );
+    free( columns );
+
+}
+
+void get_reduced_kmer_totals( hash_table_t *target_kmers,
+                              sequence_t **designed_oligos,
+                              const unsigned int *libraries, int num_oligos,
+                              const match_params_t *params
+                            )
+{
+    double span_start = stats_time();
+    int window_size = params->window_size;
+    hash_table_t *reduced_index = reduced_kmer_index( target_kmers, window_size );
+    ht_stats_t index_occupancy;
+    int index = 0;
+
+    ht_get_stats( reduced_index, &index_occupancy );
+    stats_add_table( params->stats, "reduced_index", window_size, &index_occupancy );
+
+    trace_record( params->trace, 0, "build reduced index", span_start, stats_time() );
+    span_start = stats_time();
+
+    // each reduced kmer looked up counts as one comparison
+    uint64_t num_extracted = 0;
+    uint64_t num_lookups   = 0;
+    uint64_t num_matches   = 0;
+
+    #pragma omp parallel for schedule( dynamic ) \
+            reduction( +: num_extracted, num_lookups, num_matches )
+    for( index = 0; index < num_oligos; index++ )
+        {
+            char *current_oligo = designed_oligos[ index ]->sequence->data;
+            int num_subsets = num_substrings( designed_oligos[ index ]->sequence->size,
+                                              window_size
+                                            );
+            int subset_index = 0;
+            unsigned int library = libraries ? libraries[ index ] : 0;
+            uint32_t match_index = 0;
+            char reduced_kmer[ window_size + 1 ];
+            array_list_t *matches = NULL;
+            kmer_t *current_kmer = NULL;
+            hash_table_t seen_kmers;
+
+            if( num_subsets <= 0 )
+                {
+                    continue;
+                }
+
+            ht_init_kmers( &seen_kmers, num_subsets, window_size );
+            num_extracted += num_subsets;
+
+            for( subset_index = 0; subset_index < num_subsets; subset_index++ )
+                {
+                    xmer_to_functional_groups( reduced_kmer, current_oligo + subset_index,
+                                               window_size
+                                             );
+
+                    // each distinct reduced kmer of an oligo counts once,
+                    // as each distinct kmer does in get_kmer_totals
+                    if( !ht_add( &seen_kmers, reduced_kmer, NULL ) )
+                        {
+                            continue;
+                        }
+
+                    num_lookups++;
+                    matches = (array_list_t*) ht_find( reduced_index, reduced_kmer );
+                    if( matches == NULL )
+                        {
+                            continue;
+                        }
+
+                    num_matches += matches->size;
+                    for( match_index = 0; match_index < matches->size; match_index++ )
+                        {
+                            current_kmer = matches->array_data[ match_index ];
+                            #pragma omp atomic
+                            current_kmer->kmer_score++;
+
+                            if( current_kmer->library_scores )
+                                {
+                                    #pragma omp atomic
+                                    current_kmer->library_scores[ library ]++;
+                                }
+                        }
+                }
+            ht_clear( &seen_kmers );
+        }
+
+    params->stats->kmers_extracted += num_extracted;
+    params->stats->comparisons     += num_lookups;
+    params->stats->matches         += num_matches;
+    trace_record( params->trace, 0, "count reduced", span_start, stats_time() );
+
+    clear_reduced_index( reduced_index );
+}
+
+static hash_table_t *reduced_kmer_index( hash_table_t *target_kmers, int window_size )
+{
+    hash_table_t *reduced_index = malloc( sizeof( hash_table_t ) );
+    HT_Entry **items = ht_get_items( target_kmers );
+    array_list_t *matches = NULL;
+    char reduced_kmer[ window_size + 1 ];
+    unsigned int index = 0;
+
+    ht_init_kmers( reduced_index, target_kmers->size > 0 ? target_kmers->size : 1, window_size );
+
+    for( index = 0; index < target_kmers->size; index++ )
+        {
+            xmer_to_functional_groups( reduced_kmer, items[ index ]->key, window_size );
+
+            matches = (array_list_t*) ht_find( reduced_index, reduced_kmer );
+            if( matches == NULL )
+                {
+                    matches = malloc( sizeof( array_list_t ) );
+                    ar_init( matches );
+                    ht_add( reduced_index, reduced_kmer, matches );
+                }
+            ar_add( matches, items[ index ]->value );
+        }
+
+    free( items );
+    return reduced_index;
+}
+
+static void clear_reduced_index( hash_table_t *index )
+{
+    HT_Entry **items = ht_get_items( index );
+    unsigned int item_index = 0;
+
+    for( item_index = 0; item_index < index->size; item_index++ )
+        {
+            ar_clear( items[ item_index ]->value );
+        }
+
+    free( items );
+    ht_clear( index );
+    free( index );
+}
+
+static inline bool tolerable_match( char *a, char *b, int size, int num_mismatches )
+{
+    int index = 0;
+    int mismatches = 0;
+
+
+    for( index = 0; index < size; index++ )
+        {
+            if( a[ index ] - b[ index ] )
+                {
+                    mismatches++;
+                    if( mismatches > num_mismatches )
+                        {
+                            return false;
+                        }
+                }
+        }
+    return true;
+}
+
+sequence_t **count_and_read_seqs( char *filename )
+{
+
+    FILE *open_file = NULL;
+    sequence_t **local_seqs = NULL;
+    int num_seqs = 0;
+
+    char local_filename[ MAX_STRING_SIZE ];
+
+    strcpy( local_filename, filename );
+
+    open_file = fopen( local_filename, "r" );
+
+    num_seqs = count_seqs_in_file( open_file );
+
+    local_seqs = malloc( sizeof( sequence_t *) * num_seqs );
+
+    read_sequences( open_file, local_seqs );
+
+    fclose( open_file );
+
+    return local_seqs;
+
+}
+
+static void substring_indices( char *src, char *dest, const int start, const int end )
+{
+    int index       = 0;
+    int inner_index = 0;
+
+    for( index = start; index < end; index++ )
+        {
+            dest[ inner_index ] = src[ index ];
+
+            dest[ ++inner_index ] = '\0';
+        }
+}
+
+static inline int num_substrings( const int str_len, const int window_size )
+{
+    return str_len - window_size + 1;
+}
+
+static void subset_lists_ht( hash_table_t *dest, char *seq,
+                              int sequence_len, const int window_size )
+{
+    int seq_len = sequence_len;
+    int num_substr = num_substrings( seq_len, window_size );
+    int index = 0;
+
+    unsigned int start = 0;
+    unsigned int end   = 0;
+    
+    char *substr;
+
+    kmer_t *new_kmer = NULL;
+
+    for( index = 0; index < num_substr; index++ )
+        {
+            substr = malloc( sizeof( char ) * window_size + 1 );
+            substr[ 0 ] = '\0';
+
+            start = index;
+            end   = index + window_size;
+            substring_indices( seq, substr, start,
+                               end
+                             );
+
+            if( !ht_find( dest, substr ) )
+                {
+                    new_kmer = malloc( sizeof( kmer_t ) );
+
+                    kmer_init( new_kmer, substr,
+                               start, end, 0
+                             );
+                    ht_add( dest, new_kmer->seq, new_kmer );
+                }
+        }
+}
+
+hash_table_t **seqs_to_kmer_tables( sequence_t **seqs, const int num_seqs,
+                                    const int *window_sizes, int num_window_sizes,
+                                    run_stats_t *stats
+                                  )
+{
+    hash_table_t **tables = malloc( num_window_sizes * sizeof( hash_table_t* ) );
+    kmer_t *new_kmer      = NULL;
+    char *substr          = NULL;
+
+    int index        = 0;
+    int seq_len      = 0;
+    int start        = 0;
+    int window_index = 0;
+
+    for( window_index = 0; window_index < num_window_sizes; window_index++ )
+        {
+            tables[ window_index ] = malloc( sizeof( hash_table_t ) );
+            ht_init_kmers( tables[ window_index ], LARGE_TABLE_SIZE, window_sizes[ window_index ] );
+        }
+
+    // one pass over each sequence extracts the kmer of every window
+    // size that fits at each start, so sequences are only walked once
+    for( index = 0; index < num_seqs; index++ )
+        {
+            seq_len = strlen( seqs[ index ]->sequence->data );
+
+            for( start = 0; start < seq_len; start++ )
+                {
+                    for( window_index = 0; window_index < num_window_sizes; window_index++ )
+                        {
+                            if( start + window_sizes[ window_index ] > seq_len )
+                                {
+                                    continue;
+                                }
+
+                            substr   = malloc( sizeof( char ) * window_sizes[ window_index ] + 1 );
+                            new_kmer = malloc( sizeof( kmer_t ) );
+
+                            substr[ 0 ] = '\0';
+                            substring_indices( seqs[ index ]->sequence->data, substr, start,
+                                               start + window_sizes[ window_index ]
+                                             );
+
+                            kmer_init( new_kmer, substr, start,
+                                       start + window_sizes[ window_index ], 0
+                                     );
+                            new_kmer->protein_index = index;
+                            stats->kmers_extracted++;
+
+                            add_valid_kmers( &new_kmer, 1, tables[ window_index ] );
+                        }
+                }
+        }
+
+    return tables;
+}
+
+unsigned int get_mismatch_counts( item_scores_t *scores, HT_Entry **items, char *kmer,
+                                  unsigned int num_items, int num_mismatches,
+                                  unsigned int library
+                                )
+
+{
+    unsigned int num_matches = 0;
+    unsigned int index = 0;
+    unsigned int oligo_size = strlen( items[ 0 ]->key );
+    HT_Entry *current_item = NULL;
+
+    for( index = 0; index < num_items; index++ )
+        {
+            current_item = items[ index ];
+
+            if( tolerable_match( current_item->key, kmer, oligo_size, num_mismatches ) )
+                {
+                    add_item_score( scores, index, library, 1 );
+                    num_matches++;
+                }
+            
+        }
+    return num_matches;
+}
+
+unsigned int get_substitution_counts( item_scores_t *scores,
+                                      const uint8_t *item_codes, char *kmer,
+                                      unsigned int num_items, const match_params_t *params,
+                                      unsigned int library
+                                    )
+{
+    unsigned int num_matches = 0;
+    unsigned int index = 0;
+    unsigned int position = 0;
+    unsigned int kmer_size = strlen( kmer );
+    unsigned int code = 0;
+    int mismatches = 0;
+    int weight = 0;
+    uint8_t kmer_code = 0;
+    const uint8_t *current_codes = NULL;
+    const blosum_data_t *blosum = params->blosum_data;
+
+    // per-position lookup rows, so that scoring a target kmer
+    // is a fixed-length sum with no data-dependent branches
+    uint8_t penalties[ kmer_size ][ NUM_RESIDUE_CODES ];
+    int weights[ kmer_size ][ NUM_RESIDUE_CODES ];
+
+    // a pair missing from the matrix is a mismatch that adds no weight
+    for( position = 0; position < kmer_size; position++ )
+        {
+            kmer_code = residue_to_code( kmer[ position ] );
+            for( code = 0; code < NUM_RESIDUE_CODES; code++ )
+                {
+                    if( blosum->distances[ kmer_code ][ code ] == BLOSUM_DATA_NOT_FOUND )
+                        {
+                            penalties[ position ][ code ] = 1;
+                            weights[ position ][ code ]   = 0;
+                            continue;
+                        }
+                    penalties[ position ][ code ] = code != kmer_code &&
+                        !( ( blosum->allowed[ kmer_code ] >> code ) & 1 );
+                    weights[ position ][ code ] = blosum->distances[ kmer_code ][ code ];
+                }
+        }
+
+    for( index = 0; index < num_items; index++ )
+        {
+            current_codes = item_codes + ( (size_t) index * kmer_size );
+            mismatches = 0;
+            weight = 0;
+
+            for( position = 0; position < kmer_size; position++ )
+                {
+                    mismatches += penalties[ position ][ current_codes[ position ] ];
+                    weight     += weights[ position ][ current_codes[ position ] ];
+                }
+
+            if( mismatches <= params->num_mismatches )
+                {
+                    num_matches++;
+                    if( !params->weighted )
+                        {
+                            add_item_score( scores, index, library, 1 );
+                        }
+                    else if( weight > 0 )
+                        {
+                            add_item_score( scores, index, library, weight );
+                        }
+                }
+        }
+    return num_matches;
+}
+
+static uint8_t *encode_items( HT_Entry **items, unsigned int num_items, int window_size )
+{
+    uint8_t *codes = malloc( (size_t) num_items * window_size );
+    unsigned int index = 0;
+    int position = 0;
+
+    for( index = 0; index < num_items; index++ )
+        {
+            for( position = 0; position < window_size; position++ )
+                {
+                    codes[ (size_t) index * window_size + position ] =
+                        residue_to_code( items[ index ]->key[ position ] );
+                }
+        }
+    return codes;
+}
+
+// the characters of each item by position, for count_mismatches
+static char *item_columns( HT_Entry **items, unsigned int num_items, int window_size )
+{
+    char *columns = malloc( (size_t) num_items * window_size );
+    unsigned int index = 0;
+    int position = 0;
+
+    for( index = 0; index < num_items; index++ )
+        {
+            for( position = 0; position < window_size; position++ )
+                {
+                    columns[ (size_t) position * num_items + index ] = items[ index ]->key[ position ];
+                }
+        }
+    return columns;
+}
+
+// the same counts as get_mismatch_counts, with the comparisons done by
+// the count_mismatches kernel of the selected instruction set
+static unsigned int get_column_mismatch_counts( item_scores_t *scores,
+                                                const char *columns, char *kmer,
+                                                unsigned int num_items, int num_mismatches,
+                                                unsigned int library, uint8_t *mismatches
+                                              )
+{
+    unsigned int num_matches = 0;
+    unsigned int index = 0;
+
+    count_mismatches( columns, num_items, kmer, strlen( kmer ), mismatches );
+    for( index = 0; index < num_items; index++ )
+        {
+            if( mismatches[ index ] <= num_mismatches )
+                {
+                    add_item_score( scores, index, library, 1 );
+                    num_matches++;
+                }
+        }
+    return num_matches;
+}
+
+void kmer_init( kmer_t *kmer, char *seq,
+                unsigned int start,
+                unsigned int end, unsigned int score
+              )
+{
+    kmer->seq = seq;
+
+    kmer->kmer_start = start;
+    kmer->kmer_end   = end;
+    kmer->kmer_score = score;
+    kmer->protein_index = 0;
+    kmer->library_scores = NULL;
+}
+
+void item_scores_init( item_scores_t *scores, unsigned int num_items,
+                       unsigned int num_libraries
+                     )
+{
+    scores->num_libraries  = num_libraries;
+    scores->totals         = calloc( num_items, sizeof( unsigned int ) );
+    scores->library_totals = NULL;
+    if( num_libraries > 1 )
+        {
+            scores->library_totals = calloc( (size_t) num_items * num_libraries,
+                                             sizeof( unsigned int )
+                                           );
+        }
+}
+
+void item_scores_add_to( const item_scores_t *scores, HT_Entry **items,
+                         unsigned int num_items
+                       )
+{
+    kmer_t *current_kmer = NULL;
+    unsigned int index = 0;
+    unsigned int library = 0;
+
+    for( index = 0; index < num_items; index++ )
+        {
+            current_kmer = items[ index ]->value;
+            current_kmer->kmer_score += scores->totals[ index ];
+            for( library = 0;
+                 scores->library_totals && current_kmer->library_scores
+                     && library < scores->num_libraries;
+                 library++
+               )
+                {
+                    current_kmer->library_scores[ library ] +=
+                        scores->library_totals[ (size_t) index * scores->num_libraries + library ];
+                }
+        }
+}
+
+void item_scores_clear( item_scores_t *scores )
+{
+    free( scores->totals );
+    free( scores->library_totals );
+    scores->totals         = NULL;
+    scores->library_totals = NULL;
+}
+
+static inline void add_item_score( item_scores_t *scores, unsigned int index,
+                                   unsigned int library, unsigned int amount
+                                 )
+{
+    scores->totals[ index ] += amount;
+    if( scores->library_totals )
+        {
+            scores->library_totals[ (size_t) index * scores->num_libraries + library ] += amount;
+        }
+}
+
+unsigned int library_score( const kmer_t *kmer, unsigned int library )
+{
+    return kmer->library_scores ? kmer->library_scores[ library ] : kmer->kmer_score;
+}
+
+bool read_design_libraries( design_libraries_t *designs, char *file_list )
+{
+    char *list_copy = malloc( strlen( file_list ) + 1 );
+    char *file_name = NULL;
+    FILE *open_file = NULL;
+    sequence_t **library_oligos = NULL;
+    unsigned int library = 0;
+    int num_library_oligos = 0;
+    int index = 0;
+
+    designs->file_names    = NULL;
+    designs->num_libraries = 0;
+    designs->oligos        = NULL;
+    designs->libraries     = NULL;
+    designs->num_oligos    = 0;
+
+    strcpy( list_copy, file_list );
+
+    for( file_name = strtok( list_copy, "," ); file_name; file_name = strtok( NULL, "," ) )
+        {
+            open_file = fopen( file_name, "r" );
+            if( !open_file )
+                {
+                    printf( "Unable to open design file %s\n", file_name );
+                    free( list_copy );
+                    clear_design_libraries( designs );
+                    return false;
+                }
+            num_library_oligos = count_seqs_in_file( open_file );
+            fclose( open_file );
+
+            library = designs->num_libraries++;
+            designs->file_names = realloc( designs->file_names,
+                                           designs->num_libraries * sizeof( char* )
+                                         );
+            designs->file_names[ library ] = malloc( strlen( file_name ) + 1 );
+            strcpy( designs->file_names[ library ], file_name );
+
+            designs->oligos    = realloc( designs->oligos,
+                                          ( designs->num_oligos + num_library_oligos )
+                                          * sizeof( sequence_t* )
+                                        );
+            designs->libraries = realloc( designs->libraries,
+                                          ( designs->num_oligos + num_library_oligos )
+                                          * sizeof( unsigned int )
+                                        );
+
+            library_oligos = count_and_read_seqs( file_name );
+            for( index = 0; index < num_library_oligos; index++ )
+                {
+                    designs->oligos[ designs->num_oligos ]    = library_oligos[ index ];
+                    designs->libraries[ designs->num_oligos ] = library;
+                    designs->num_oligos++;
+                }
+            free( library_oligos );
+        }
+
+    free( list_copy );
+
+    if( designs->num_libraries == 0 )
+        {
+            printf( "No design files given\n" );
+            return false;
+        }
+    return true;
+}
+
+void clear_design_libraries( design_libraries_t *designs )
+{
+    unsigned int library = 0;
+
+    for( library = 0; library < designs->num_libraries; library++ )
+        {
+            free( designs->file_names[ library ] );
+        }
+    clear_seqs( designs->oligos, designs->num_oligos );
+
+    free( designs->file_names );
+    free( designs->oligos );
+    free( designs->libraries );
+}
+
+void add_library_scores( hash_table_t *target_kmers, unsigned int num_libraries )
+{
+    HT_Entry **items = NULL;
+    unsigned int index = 0;
+
+    if( num_libraries < 2 )
+        {
+            return;
+        }
+
+    items = ht_get_items( target_kmers );
+    for( index = 0; index < target_kmers->size; index++ )
+        {
+            ( (kmer_t*) items[ index ]->value )->library_scores =
+                calloc( num_libraries, sizeof( unsigned int ) );
+        }
+    free( items );
+}
+
+void count_oligos( hash_table_t *target_kmers, const design_libraries_t *designs,
+                   int first_oligo, int num_oligos,
+                   bool reduced_alphabet, const match_params_t *params
+                 )
+{
+    if( num_oligos <= 0 )
+        {
+            return;
+        }
+
+    if( reduced_alphabet )
+        {
+            get_reduced_kmer_totals( target_kmers, designs->oligos + first_oligo,
+                                     designs->libraries + first_oligo, num_oligos,
+                                     params
+                                   );
+        }
+    else
+        {
+            get_kmer_totals( target_kmers, designs->oligos + first_oligo,
+                             designs->libraries + first_oligo, num_oligos,
+                             designs->num_libraries, params
+                           );
+        }
+}
+
+static int compare_items_by_kmer( const void *first, const void *second )
+{
+    return strcmp( ( *(HT_Entry * const *) first )->key,
+                   ( *(HT_Entry * const *) second )->key
+                 );
+}
+
+static int compare_items_by_score( const void *first, const void *second )
+{
+    const kmer_t *first_kmer  = ( *(HT_Entry * const *) first )->value;
+    const kmer_t *second_kmer = ( *(HT_Entry * const *) second )->value;
+
+    // highest score first, ties broken by kmer so the order is total
+    if( first_kmer->kmer_score != second_kmer->kmer_score )
+        {
+            return first_kmer->kmer_score > second_kmer->kmer_score ? -1 : 1;
+        }
+    return compare_items_by_kmer( first, second );
+}
+
+static void merge_items( HT_Entry **dest, HT_Entry **src,
+                         unsigned int start, unsigned int middle, unsigned int end,
+                         item_compare_t compare
+                       )
+{
+    unsigned int left  = start;
+    unsigned int right = middle;
+    unsigned int out   = start;
+
+    while( left < middle && right < end )
+        {
+            if( compare( &src[ right ], &src[ left ] ) < 0 )
+                {
+                    dest[ out++ ] = src[ right++ ];
+                }
+            else
+                {
+                    dest[ out++ ] = src[ left++ ];
+                }
+        }
+
+    memcpy( dest + out, src + left, ( middle - left ) * sizeof( HT_Entry* ) );
+    out += middle - left;
+    memcpy( dest + out, src + right, ( end - right ) * sizeof( HT_Entry* ) );
+}
+
+void sort_items( HT_Entry **items, unsigned int num_items, sort_order_t order )
+{
+    item_compare_t compare = order == SORT_BY_SCORE ? compare_items_by_score
+                                                    : compare_items_by_kmer;
+    int num_chunks = omp_get_max_threads();
+    int chunk = 0;
+    int width = 0;
+    unsigned int *bounds = NULL;
+    HT_Entry **buffer  = NULL;
+    HT_Entry **src     = items;
+    HT_Entry **dest    = NULL;
+    HT_Entry **swap    = NULL;
+
+    if( order == SORT_NONE )
+        {
+            return;
+        }
+
+    if( num_chunks <= 1 || num_items < (unsigned int) num_chunks * MIN_SORT_CHUNK )
+        {
+            qsort( items, num_items, sizeof( HT_Entry* ), compare );
+            return;
+        }
+
+    // sort one chunk per thread, then merge neighbouring runs pairwise
+    bounds = malloc( ( num_chunks + 1 ) * sizeof( unsigned int ) );
+    for( chunk = 0; chunk <= num_chunks; chunk++ )
+        {
+            bounds[ chunk ] = (unsigned int) ( ( (uint64_t) num_items * chunk ) / num_chunks );
+        }
+
+    #pragma omp parallel for
+    for( chunk = 0; chunk < num_chunks; chunk++ )
+        {
+            qsort( items + bounds[ chunk ], bounds[ chunk + 1 ] - bounds[ chunk ],
+                   sizeof( HT_Entry* ), compare
+                 );
+        }
+
+    buffer = malloc( num_items * sizeof( HT_Entry* ) );
+    dest = buffer;
+
+    for( width = 1; width < num_chunks; width *= 2 )
+        {
+            #pragma omp parallel for
+            for( chunk = 0; chunk < num_chunks; chunk += 2 * width )
+                {
+                    int middle = chunk + width < num_chunks ? chunk + width : num_chunks;
+                    int end    = chunk + 2 * width < num_chunks ? chunk + 2 * width : num_chunks;
+
+                    merge_items( dest, src, bounds[ chunk ], bounds[ middle ], bounds[ end ],
+                                 compare
+                               );
+                }
+
+            swap = src;
+            src  = dest;
+            dest = swap;
+        }
+
+    if( src != items )
+        {
+            memcpy( items, src, num_items * sizeof( HT_Entry* ) );
+        }
+
+    free( buffer );
+    free( bounds );
+}
+
+static void heap_sift_up( item_heap_t *heap, unsigned int index )
+{
+    HT_Entry *to_move = heap->items[ index ];
+    unsigned int parent = 0;
+
+    while( index > 0 )
+        {
+            parent = ( index - 1 ) / 2;
+            if( compare_items_by_score( &heap->items[ parent ], &to_move ) >= 0 )
+                {
+                    break;
+                }
+            heap->items[ index ] = heap->items[ parent ];
+            index = parent;
+        }
+    heap->items[ index ] = to_move;
+}
+
+static void heap_sift_down( item_heap_t *heap, unsigned int index )
+{
+    HT_Entry *to_move = heap->items[ index ];
+    unsigned int child = 0;
+
+    while( ( child = 2 * index + 1 ) < heap->size )
+        {
+            if( child + 1 < heap->size
+                && compare_items_by_score( &heap->items[ child + 1 ], &heap->items[ child ] ) > 0
+              )
+                {
+                    child++;
+                }
+            if( compare_items_by_score( &heap->items[ child ], &to_move ) <= 0 )
+                {
+                    break;
+                }
+            heap->items[ index ] = heap->items[ child ];
+            index = child;
+        }
+    heap->items[ index ] = to_move;
+}
+
+// keeps the capacity best items seen, the worst kept item is at the root
+static void heap_push( item_heap_t *heap, HT_Entry *item )
+{
+    if( heap->size < heap->capacity )
+        {
+            if( !heap->items )
+                {
+                    heap->items = malloc( heap->capacity * sizeof( HT_Entry* ) );
+                }
+            heap->items[ heap->size++ ] = item;
+            heap_sift_up( heap, heap->size - 1 );
+        }
+    else if( heap->capacity > 0
+             && compare_items_by_score( &item, &heap->items[ 0 ] ) < 0
+           )
+        {
+            heap->items[ 0 ] = item;
+            heap_sift_down( heap, 0 );
+        }
+}
+
+/**
+ * Reduces items to the best num_kept items, by score
+ * Note: each thread fills its own heap from a slice of items, the
+ *       heaps are then reduced into that of the first thread
+ * @returns number of items kept, which are moved to the front of items
+ *          in score order
+ **/
+static unsigned int keep_top_items( HT_Entry **items, unsigned int num_items,
+                                    unsigned int num_kept
+                                  )
+{
+    int num_threads = omp_get_max_threads();
+    item_heap_t *heaps = calloc( num_threads, sizeof( item_heap_t ) );
+    unsigned int index = 0;
+    unsigned int kept  = 0;
+    int thread = 0;
+
+    // a heap never holds more than every item
+    for( thread = 0; thread < num_threads; thread++ )
+        {
+            heaps[ thread ].capacity = num_kept < num_items ? num_kept : num_items;
+        }
+
+    #pragma omp parallel for
+    for( index = 0; index < num_items; index++ )
+        {
+            heap_push( &heaps[ omp_get_thread_num() ], items[ index ] );
+        }
+
+    for( thread = 1; thread < num_threads; thread++ )
+        {
+            for( index = 0; index < heaps[ thread ].size; index++ )
+                {
+                    heap_push( &heaps[ 0 ], heaps[ thread ].items[ index ] );
+                }
+        }
+
+    kept = heaps[ 0 ].size;
+    memcpy( items, heaps[ 0 ].items, kept * sizeof( HT_Entry* ) );
+    qsort( items, kept, sizeof( HT_Entry* ), compare_items_by_score );
+
+    for( thread = 0; thread < num_threads; thread++ )
+        {
+            free( heaps[ thread ].items );
+        }
+    free( heaps );
+
+    return kept;
+}
+
+/**
+ * Reduces items to the best num_kept items of each reference sequence
+ * Note: items are first grouped by protein, then each thread selects
+ *       whole groups with one heap, so only one heap per thread is needed
+ * @returns number of items kept, which are moved to the front of items
+ *          in protein order, and in score order within each protein
+ **/
+static unsigned int keep_top_per_protein( HT_Entry **items, unsigned int num_items,
+                                          unsigned int num_kept, unsigned int num_proteins
+                                        )
+{
+    unsigned int *offsets = calloc( num_proteins + 1, sizeof( unsigned int ) );
+    unsigned int *cursors = malloc( num_proteins * sizeof( unsigned int ) );
+    unsigned int *num_group_kept = malloc( num_proteins * sizeof( unsigned int ) );
+    HT_Entry **grouped = malloc( num_items * sizeof( HT_Entry* ) );
+    unsigned int largest_group = 0;
+    unsigned int protein = 0;
+    unsigned int index = 0;
+    unsigned int kept  = 0;
+
+    for( index = 0; index < num_items; index++ )
+        {
+            offsets[ ( (kmer_t*) items[ index ]->value )->protein_index + 1 ]++;
+        }
+    for( protein = 0; protein < num_proteins; protein++ )
+        {
+            if( offsets[ protein + 1 ] > largest_group )
+                {
+                    largest_group = offsets[ protein + 1 ];
+                }
+            offsets[ protein + 1 ] += offsets[ protein ];
+            cursors[ protein ] = offsets[ protein ];
+        }
+    if( num_kept > largest_group )
+        {
+            num_kept = largest_group;
+        }
+    for( index = 0; index < num_items; index++ )
+        {
+            protein = ( (kmer_t*) items[ index ]->value )->protein_index;
+            grouped[ cursors[ protein ]++ ] = items[ index ];
+        }
+
+    #pragma omp parallel private( index )
+    {
+        item_heap_t heap = { NULL, 0, num_kept };
+
+        #pragma omp for schedule( dynamic, 16 )
+        for( protein = 0; protein < num_proteins; protein++ )
+            {
+                heap.size = 0;
+                for( index = offsets[ protein ]; index < offsets[ protein + 1 ]; index++ )
+                    {
+                        heap_push( &heap, grouped[ index ] );
+                    }
+
+                // the group's slice is at least as long as its heap
+                memcpy( grouped + offsets[ protein ], heap.items, heap.size * sizeof( HT_Entry* ) );
+                qsort( grouped + offsets[ protein ], heap.size, sizeof( HT_Entry* ),
+                       compare_items_by_score
+                     );
+                num_group_kept[ protein ] = heap.size;
+            }
+
+        free( heap.items );
+    }
+
+    for( protein = 0; protein < num_proteins; protein++ )
+        {
+            memcpy( items + kept, grouped + offsets[ protein ],
+                    num_group_kept[ protein ] * sizeof( HT_Entry* )
+                  );
+            kept += num_group_kept[ protein ];
+        }
+
+    free( grouped );
+    free( num_group_kept );
+    free( cursors );
+    free( offsets );
+
+    return kept;
+}
+
+unsigned int filter_items( HT_Entry **items, unsigned int num_items,
+                           const output_filter_t *filter, unsigned int num_proteins
+                         )
+{
+    unsigned int index = 0;
+    unsigned int kept  = 0;
+
+    if( filter->min_score > 0 )
+        {
+            for( index = 0; index < num_items; index++ )
+                {
+                    if( ( (kmer_t*) items[ index ]->value )->kmer_score >= filter->min_score )
+                        {
+                            items[ kept++ ] = items[ index ];
+                        }
+                }
+            num_items = kept;
+        }
+
+    if( filter->top_per_protein > 0 )
+        {
+            num_items = keep_top_per_protein( items, num_items, filter->top_per_protein,
+                                              num_proteins
+                                            );
+        }
+
+    if( filter->top > 0 )
+        {
+            num_items = keep_top_items( items, num_items, filter->top );
+        }
+
+    return num_items;
+}
+
+static inline int uint_length( unsigned int value )
+{
+    int length = 1;
+
+    while( value >= 10 )
+        {
+            value /= 10;
+            length++;
+        }
+    return length;
+}
+
+static inline int format_uint( char *dest, unsigned int value )
+{
+    int length = uint_length( value );
+    int index  = length - 1;
+
+    do
+        {
+            dest[ index-- ] = '0' + ( value % 10 );
+            value /= 10;
+        }
+    while( value );
+
+    return length;
+}
+
+static inline size_t output_row_length( HT_Entry *item, unsigned int num_libraries )
+{
+    kmer_t *current_kmer = item->value;
+    unsigned int library = 0;
+
+    // key, the scores, start and end, a tab before each number and a newline
+    size_t length = strlen( item->key )
+                    + uint_length( current_kmer->kmer_start )
+                    + uint_length( current_kmer->kmer_end )
+                    + num_libraries + 3;
+
+    for( library = 0; library < num_libraries; library++ )
+        {
+            length += uint_length( library_score( current_kmer, library ) );
+        }
+    return length;
+}
+
+static inline size_t format_output_row( char *dest, HT_Entry *item, unsigned int num_libraries )
+{
+    kmer_t *current_kmer = item->value;
+    size_t key_length = strlen( item->key );
+    size_t length = 0;
+    unsigned int library = 0;
+
+    memcpy( dest, item->key, key_length );
+    length += key_length;
+    for( library = 0; library < num_libraries; library++ )
+        {
+            dest[ length++ ] = '\t';
+            length += format_uint( dest + length, library_score( current_kmer, library ) );
+        }
+    dest[ length++ ] = '\t';
+    length += format_uint( dest + length, current_kmer->kmer_start );
+    dest[ length++ ] = '\t';
+    length += format_uint( dest + length, current_kmer->kmer_end );
+    dest[ length++ ] = '\n';
+
+    return length;
+}
+
+static bool pwrite_all( int fd, const char *data, size_t length, off_t offset )
+{
+    ssize_t written = 0;
+
+    while( length > 0 )
+        {
+            written = pwrite( fd, data, length, offset );
+            if( written < 0 )
+                {
+                    return false;
+                }
+            data   += written;
+            length -= written;
+            offset += written;
+        }
+    return true;
+}
+
+void write_outputs( char *out_file, HT_Entry **items, unsigned int num_items,
+                    unsigned int num_libraries
+                  )
+{
+    int out_fd = open( out_file, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+
+    // a "Score_N" column name for each library, as results_write_tsv names them
+    char *header = malloc( 32 + num_libraries * 16 );
+    size_t header_length = 0;
+    unsigned int library = 0;
+
+    int num_slices = omp_get_max_threads();
+    size_t *slice_offsets = NULL;
+    bool write_failed = false;
+
+    if( out_fd < 0 )
+        {
+            printf( "Unable to open file %s for output.\n", out_file );
+            free( header );
+            return;
+        }
+
+    header_length = sprintf( header, "Kmer" );
+    for( library = 0; library < num_libraries; library++ )
+        {
+            header_length += num_libraries == 1
+                             ? sprintf( header + header_length, "\tScore" )
+                             : sprintf( header + header_length, "\tScore_%u", library + 1 );
+        }
+    header_length += sprintf( header + header_length, "\tStart\tEnd\n" );
+
+    // slice_offsets[ i ] is where slice i's rows start in the file
+    slice_offsets = calloc( num_slices + 1, sizeof( size_t ) );
+    slice_offsets[ 0 ] = header_length;
+    write_failed = !pwrite_all( out_fd, header, header_length, 0 );
+    free( header );
+
+    #pragma omp parallel num_threads( num_slices )
+    {
+        int slice = omp_get_thread_num();
+        int slice_count = omp_get_num_threads();
+        unsigned int first = (unsigned int) ( ( (uint64_t) num_items * slice ) / slice_count );
+        unsigned int last  = (unsigned int) ( ( (uint64_t) num_items * ( slice + 1 ) ) / slice_count );
+        unsigned int index = 0;
+
+        size_t slice_length = 0;
+        size_t buffered = 0;
+        off_t offset = 0;
+        char *buffer = NULL;
+
+        for( index = first; index < last; index++ )
+            {
+                slice_length += output_row_length( items[ index ], num_libraries );
+            }
+        slice_offsets[ slice + 1 ] = slice_length;
+
+        #pragma omp barrier
+        #pragma omp single
+        {
+            for( index = 1; index <= (unsigned int) slice_count; index++ )
+                {
+                    slice_offsets[ index ] += slice_offsets[ index - 1 ];
+                }
+        }
+
+        offset = slice_offsets[ slice ];
+        buffer = malloc( OUTPUT_BUFFER_SIZE );
+
+        for( index = first; index < last; index++ )
+            {
+                if( buffered + MAX_OUTPUT_ROW_SIZE( num_libraries ) > OUTPUT_BUFFER_SIZE )
+                    {
+                        if( !pwrite_all( out_fd, buffer, buffered, offset ) )
+                            {
+                                #pragma omp atomic write
+                                write_failed = true;
+                            }
+                        offset  += buffered;
+                        buffered = 0;
+                    }
+                buffered += format_output_row( buffer + buffered, items[ index ], num_libraries );
+            }
+
+        if( buffered && !pwrite_all( out_fd, buffer, buffered, offset ) )
+            {
+                #pragma omp atomic write
+                write_failed = true;
+            }
+
+        free( buffer );
+    }
+
+    if( write_failed )
+        {
+            printf( "Failed to write output to %s.\n", out_file );
+        }
+
+    close( out_fd );
+    free( slice_offsets );
+}
+
+bool write_binary_outputs( char *out_file, HT_Entry **items, unsigned int num_items,
+                           char *ref_file, const design_libraries_t *designs,
+                           char **design_files, const match_params_t *params,
+                           const score_settings_t *scoring
+                         )
+{
+    kmer_t *current_kmer = NULL;
+    kmer_results_t results;
+    unsigned int index = 0;
+    unsigned int library = 0;
+    bool success = false;
+
+    results_init( &results, num_items, designs->num_libraries,
+                  params->window_size, params->num_mismatches
+                );
+    results_set_inputs( &results, ref_file, design_files );
+    results_set_scoring( &results, scoring );
+
+    for( index = 0; index < num_items; index++ )
+        {
+            current_kmer = items[ index ]->value;
+
+            results.codes[ index ]  = kmer_pack( items[ index ]->key, params->window_size );
+            for( library = 0; library < designs->num_libraries; library++ )
+                {
+                    results_column( &results, library )[ index ] = library_score( current_kmer, library );
+                }
+            results.starts[ index ] = current_kmer->kmer_start;
+            results.ends[ index ]   = current_kmer->kmer_end;
+        }
+
+    success = results_write( &results, out_file );
+    if( !success )
+        {
+            printf( "Failed to write output to %s.\n", out_file );
+        }
+
+    results_clear( &results );
+    return success;
+}
+
+void clear_table( hash_table_t *table )
+{
+    HT_Entry **items = NULL;
+    unsigned int index = 0;
+
+    items = ht_get_items( table );
+
+    for( index = 0; index < table->size; index++ )
+        {
+            free( ( (kmer_t*) items[ index ]->value )->library_scores );
+            free( items[ index ]->value );
+        }
+
+
+    ht_clear( table );
+    free( table );
+    free( items );
+}
+
+static inline void add_valid_kmers( kmer_t **kmers, const unsigned int num_subsets, hash_table_t *table )
+{
+    unsigned int index;
+    kmer_t *current_kmer = NULL;
+
+    bool delete_flag = false;
+
+    for( index = 0; index < num_subsets; index++ )
+        {
+            current_kmer = kmers[ index ];
+            if( strchr( current_kmer->seq, 'X' ) == NULL )
+                {
+                    if( !ht_find( table, current_kmer->seq ) )
+                        {
+                            ht_add( table,
+                                    current_kmer->seq,
+                                    current_kmer
+                                    );
+                        }
+                    else
+                        {
+                            delete_flag = true;
+                        }
+                }
+            else
+                {
+                    delete_flag = true;
+                }
+
+            if( delete_flag )
+                {
+                    delete_flag = false;
+
+                    free( current_kmer->seq );
+                    free( current_kmer );
+                }
+        }
+}
+
+
+ 
+void clear_seqs( sequence_t **seqs, int num_seqs )
+{
+    int index = 0;
+
+    for( index = 0; index < num_seqs; index++ )
+        {
+            ds_clear( seqs[ index ]->sequence );
+            free( seqs[ index ]->name );
+            free( seqs[ index ] );
+        }
+}
@@ -0,0 +1,305 @@
+#ifndef KMER_COUNTS_H_INCLUDED
+#define KMER_COUNTS_H_INCLUDED
+
+#include <omp.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hash_table.h"
+#include "protein_oligo_library.h"
+#include "run_stats.h"
+#include "trace.h"
+#include "kmer_results.h"
+#include "perf_counters.h"
+
+#ifndef _OPENMP
+    #define omp_get_wtime() 0
+    #define omp_get_max_threads() 1
+    #define omp_get_num_threads() 1
+    #define omp_get_thread_num() 0
+#endif
+
+// default kmer length and mismatches allowed between matching kmers
+extern const int WINDOW_SIZE;
+extern const int NUM_MISMATCHES;
+
+// longest file name or sequence line handled
+extern const int MAX_STRING_SIZE;
+
+typedef struct kmer
+{
+    char *seq;
+    unsigned int kmer_start;
+    unsigned int kmer_end;
+    unsigned int kmer_score;
+
+    // reference sequence the kmer was first found in
+    unsigned int protein_index;
+
+    // with several design libraries, the score from each library,
+    // kmer_score is then their sum. NULL with a single library
+    unsigned int *library_scores;
+} kmer_t;
+
+/**
+ * Scores counted for an array of target items, before they are added
+ * to the items' kmer_t values
+ * Note: totals[ i ] is the score of item i. With several libraries,
+ *       library_totals[ i * num_libraries + l ] is its score from
+ *       library l, otherwise library_totals is NULL
+ **/
+typedef struct item_scores
+{
+    unsigned int *totals;
+    unsigned int *library_totals;
+    unsigned int num_libraries;
+} item_scores_t;
+
+typedef struct design_libraries
+{
+    char **file_names;
+    unsigned int num_libraries;
+
+    // oligos of every library in order, the library of
+    // oligos[ i ] is libraries[ i ]
+    sequence_t **oligos;
+    unsigned int *libraries;
+    int num_oligos;
+} design_libraries_t;
+
+typedef struct match_params
+{
+    int num_mismatches;
+
+    // when set, positions whose substitution score meets the
+    // cutoff do not count against num_mismatches, positions whose
+    // residues are missing from the matrix always do
+    blosum_data_t *blosum_data;
+
+    // add the summed substitution score of each match instead of 1
+    bool weighted;
+
+    // length of the target and design kmers compared
+    int window_size;
+
+    // stage times and counters of the run
+    run_stats_t *stats;
+
+    // timeline of each thread's work, NULL unless --trace is given
+    trace_t *trace;
+
+    // hardware counters of each thread, NULL unless --perf-counters is given
+    perf_counters_t *perf;
+} match_params_t;
+
+typedef enum sort_order
+{
+    SORT_NONE,
+    SORT_BY_KMER,
+    SORT_BY_SCORE
+} sort_order_t;
+
+typedef int (*item_compare_t)( const void *first, const void *second );
+
+// a value of zero disables that filter
+typedef struct output_filter
+{
+    unsigned int min_score;
+    unsigned int top;
+    unsigned int top_per_protein;
+} output_filter_t;
+
+/**
+ * Reads every sequence of a fasta file
+ * @param filename string name of the file to read
+ * @returns array of the file's sequences, in file order
+ **/
+sequence_t **count_and_read_seqs( char *filename );
+
+/**
+ * Frees an array of sequences and each sequence in it
+ * @param seqs array of sequences to free
+ * @param num_seqs number of sequences in seqs
+ **/
+void clear_seqs( sequence_t **seqs, int num_seqs );
+
+/**
+ * Builds a table of the kmers of each window size found in seqs
+ * Note: Each sequence is walked once, taking the kmer of every window
+ *       size that fits at each start. Kmers holding an X are skipped,
+ *       a kmer found more than once keeps the start, end and protein
+ *       of its first occurrence
+ * @param seqs array of sequences to take kmers from
+ * @param num_seqs number of sequences in seqs
+ * @param window_sizes array of kmer lengths
+ * @param num_window_sizes number of lengths in window_sizes
+ * @param stats pointer to run_stats_t to count extracted kmers in
+ * @returns array of num_window_sizes tables, mapping each kmer to its kmer_t
+ **/
+hash_table_t **seqs_to_kmer_tables( sequence_t **seqs, const int num_seqs,
+                                    const int *window_sizes, int num_window_sizes,
+                                    run_stats_t *stats
+                                  );
+
+/**
+ * Initializes a kmer_t with no library scores
+ **/
+void kmer_init( kmer_t *kmer, char *seq, unsigned int start, unsigned int end, unsigned int score );
+
+/**
+ * Gets the score of a kmer from one design library
+ * @param kmer pointer to kmer_t to get the score of
+ * @param library index of the design library
+ * @returns the library's score, kmer_score with a single library
+ **/
+unsigned int library_score( const kmer_t *kmer, unsigned int library );
+
+/**
+ * Frees a kmer table, its kmer_t values and the table itself
+ * @param table pointer to table built by seqs_to_kmer_tables
+ **/
+void clear_table( hash_table_t *table );
+
+/**
+ * Reads a comma separated list of design library files
+ * @param designs pointer to design_libraries_t to fill
+ * @param file_list string of comma separated file names
+ * @returns boolean true if every file could be read
+ **/
+bool read_design_libraries( design_libraries_t *designs, char *file_list );
+
+/**
+ * Frees the memory held by designs, but not designs itself
+ **/
+void clear_design_libraries( design_libraries_t *designs );
+
+/**
+ * Gives each target kmer a score per design library, when there
+ * is more than one library
+ **/
+void add_library_scores( hash_table_t *target_kmers, unsigned int num_libraries );
+
+/**
+ * Adds the scores of a range of design oligos to the target kmers
+ * @param target_kmers table built by seqs_to_kmer_tables
+ * @param designs pointer to design_libraries_t holding the oligos
+ * @param first_oligo index of the first oligo to count
+ * @param num_oligos number of oligos to count
+ * @param reduced_alphabet count matches of reduced alphabet kmers
+ *        instead of kmers within params->num_mismatches
+ * @param params pointer to match_params_t to match with
+ **/
+void count_oligos( hash_table_t *target_kmers, const design_libraries_t *designs,
+                   int first_oligo, int num_oligos,
+                   bool reduced_alphabet, const match_params_t *params
+                 );
+
+/**
+ * Adds one to the score of a target kmer for each distinct kmer of
+ * each design oligo it matches, or the substitution score of the
+ * match when params->weighted is set
+ * Note: Each thread counts into its own zeroed item_scores_t, which
+ *       are added to target_kmers once counting is done
+ * @param libraries design library of each oligo, NULL with a single library
+ **/
+void get_kmer_totals( hash_table_t *target_kmers, sequence_t **designed_oligos,
+                      const unsigned int *libraries, int num_oligos,
+                      unsigned int num_libraries, const match_params_t *params );
+
+/**
+ * Initializes an item_scores_t of num_items zero scores
+ * @param scores pointer to item_scores_t to initialize
+ * @param num_items number of items to hold scores for
+ * @param num_libraries number of design libraries, 1 keeps only totals
+ **/
+void item_scores_init( item_scores_t *scores, unsigned int num_items,
+                       unsigned int num_libraries
+                     );
+
+/**
+ * Adds scores to the kmer_t values of the items they were counted for
+ * @param scores pointer to item_scores_t holding num_items scores
+ * @param items the items scores were counted for
+ **/
+void item_scores_add_to( const item_scores_t *scores, HT_Entry **items,
+                         unsigned int num_items
+                       );
+
+/**
+ * Frees the memory held by scores, but not scores itself
+ **/
+void item_scores_clear( item_scores_t *scores );
+
+/**
+ * Scores the items within num_mismatches of kmer, comparing every item
+ * @param scores pointer to item_scores_t that item i's matches are added to
+ * @returns the number of items that matched
+ **/
+unsigned int get_mismatch_counts( item_scores_t *scores, HT_Entry **items, char *kmer,
+                                  unsigned int num_items, int num_mismatches,
+                                  unsigned int library
+                                );
+
+/**
+ * Scores the items that match kmer once substitutions allowed by
+ * params->blosum_data are not counted as mismatches
+ * Note: A position whose pair of residues is missing from the matrix
+ *       is a mismatch, and adds nothing to the weight of a match
+ * @param scores pointer to item_scores_t that item i's matches are added to
+ * @param item_codes residue codes of the items, window size codes each
+ * @returns the number of items that matched
+ **/
+unsigned int get_substitution_counts( item_scores_t *scores,
+                                      const uint8_t *item_codes, char *kmer,
+                                      unsigned int num_items, const match_params_t *params,
+                                      unsigned int library
+                                    );
+
+/**
+ * Adds one to the score of a target kmer for each distinct reduced
+ * alphabet kmer of each design oligo that equals its own
+ **/
+void get_reduced_kmer_totals( hash_table_t *target_kmers, sequence_t **designed_oligos,
+                              const unsigned int *libraries, int num_oligos,
+                              const match_params_t *params
+                            );
+
+/**
+ * Moves the items that pass filter to the front of items
+ * Note: filters the finished totals, after every design is counted.
+ *       Items kept by top are in score order, items kept by
+ *       top_per_protein are in protein order then score order
+ * @param num_proteins number of reference sequences, for top_per_protein
+ * @returns the number of items kept
+ **/
+unsigned int filter_items( HT_Entry **items, unsigned int num_items,
+                           const output_filter_t *filter, unsigned int num_proteins
+                         );
+
+/**
+ * Sorts items in parallel, SORT_NONE leaves them in table order
+ **/
+void sort_items( HT_Entry **items, unsigned int num_items, sort_order_t order );
+
+/**
+ * Writes items as tab separated kmer, score and position rows
+ * Note: Threads format and write their own slices of the file
+ **/
+void write_outputs( char *out_file, HT_Entry **items, unsigned int num_items,
+                    unsigned int num_libraries
+                  );
+
+/**
+ * Writes items as a kmer_results binary file
+ * @param design_files array of the design file names recorded for each
+ *        library, which differ from designs' when adding to a previous result
+ * @param scoring pointer to the score settings recorded in the file
+ * @returns boolean success of operation
+ **/
+bool write_binary_outputs( char *out_file, HT_Entry **items, unsigned int num_items,
+                           char *ref_file, const design_libraries_t *designs,
+                           char **design_files, const match_params_t *params,
+                           const score_settings_t *scoring
+                         );
+
+#endif
@@ -0,0 +1,1343 @@
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "kmer_counts.h"
+#include "synthetic.h"
+#include "kernels.h"
+
+// most differences printed for each engine and trial
+#define MAX_REPORTED_DIFFERENCES 5
+
+// most threads an engine is run with
+#define MAX_ORACLE_THREADS 4
+
+// most design libraries the libraries check scores at once
+#define MAX_ORACLE_LIBRARIES 4
+
+// strings interned by the id_sets check, and their longest length
+#define ID_SET_STRINGS 64
+#define ID_SET_STRING_LENGTH 3
+
+// residues of the synthetic proteins, the rows of a random matrix
+static const char MATRIX_RESIDUES[] = "ARNDCQEGHILKMFPSTWYV";
+#define NUM_MATRIX_RESIDUES 20
+
+// inputs of one trial shared by the engines and the references
+typedef struct trial
+{
+    // random state for engines that split the work
+    uint64_t *state;
+
+    // random substitution matrix the weighted engine scores with
+    blosum_data_t matrix;
+} trial_t;
+
+// how the expected scores of an engine are computed
+typedef enum reference
+{
+    REFERENCE_MISMATCHES,
+    REFERENCE_WEIGHTED,
+    REFERENCE_REDUCED,
+    NUM_REFERENCES
+} reference_t;
+
+/**
+ * Scores target_kmers against the oligos, as get_kmer_totals would
+ * @param trial pointer to the inputs of the trial
+ **/
+typedef void (*engine_run_t)( hash_table_t *target_kmers, sequence_t **oligos,
+                              int num_oligos, const match_params_t *params,
+                              trial_t *trial
+                            );
+
+typedef struct engine
+{
+    const char *name;
+    engine_run_t run;
+    reference_t reference;
+} engine_t;
+
+/**
+ * Checks a part of the library that has a reference of its own
+ * @param trial_number number of the trial, for reporting differences
+ * @returns the number of differences found
+ **/
+typedef unsigned int (*check_run_t)( sequence_t **proteome, int num_proteins,
+                                     sequence_t **oligos, int num_oligos,
+                                     const match_params_t *params, trial_t *trial,
+                                     unsigned int trial_number
+                                   );
+
+typedef struct check
+{
+    const char *name;
+    check_run_t run;
+} check_t;
+
+static void run_threads( hash_table_t *target_kmers, sequence_t **oligos, int num_oligos,
+                         const match_params_t *params, trial_t *trial
+                       );
+static void run_chunked( hash_table_t *target_kmers, sequence_t **oligos, int num_oligos,
+                         const match_params_t *params, trial_t *trial
+                       );
+static void run_substitution( hash_table_t *target_kmers, sequence_t **oligos, int num_oligos,
+                              const match_params_t *params, trial_t *trial
+                            );
+static void run_weighted( hash_table_t *target_kmers, sequence_t **oligos, int num_oligos,
+                          const match_params_t *params, trial_t *trial
+                        );
+static void run_baseline( hash_table_t *target_kmers, sequence_t **oligos, int num_oligos,
+                          const match_params_t *params, trial_t *trial
+                        );
+static void run_avx2( hash_table_t *target_kmers, sequence_t **oligos, int num_oligos,
+                      const match_params_t *params, trial_t *trial
+                    );
+static void run_avx512( hash_table_t *target_kmers, sequence_t **oligos, int num_oligos,
+                        const match_params_t *params, trial_t *trial
+                      );
+static void run_reduced( hash_table_t *target_kmers, sequence_t **oligos, int num_oligos,
+                         const match_params_t *params, trial_t *trial
+                       );
+
+// engines checked against the reference, each must give the same scores
+static const engine_t ENGINES[] =
+{
+    { "threads",      run_threads,      REFERENCE_MISMATCHES },
+    { "chunked",      run_chunked,      REFERENCE_MISMATCHES },
+    { "substitution", run_substitution, REFERENCE_MISMATCHES },
+    { "weighted",     run_weighted,     REFERENCE_WEIGHTED },
+    { "baseline",     run_baseline,     REFERENCE_MISMATCHES },
+    { "avx2",         run_avx2,         REFERENCE_MISMATCHES },
+    { "avx512",       run_avx512,       REFERENCE_MISMATCHES },
+    { "reduced",      run_reduced,      REFERENCE_REDUCED }
+};
+#define NUM_ENGINES ( sizeof( ENGINES ) / sizeof( ENGINES[ 0 ] ) )
+
+static unsigned int check_xmer_locs( sequence_t **proteome, int num_proteins,
+                                     sequence_t **oligos, int num_oligos,
+                                     const match_params_t *params, trial_t *trial,
+                                     unsigned int trial_number
+                                   );
+static unsigned int check_id_sets( sequence_t **proteome, int num_proteins,
+                                   sequence_t **oligos, int num_oligos,
+                                   const match_params_t *params, trial_t *trial,
+                                   unsigned int trial_number
+                                 );
+static unsigned int check_libraries( sequence_t **proteome, int num_proteins,
+                                     sequence_t **oligos, int num_oligos,
+                                     const match_params_t *params, trial_t *trial,
+                                     unsigned int trial_number
+                                   );
+
+// checks run after the engines of each trial, selected by name like engines
+static const check_t CHECKS[] =
+{
+    { "xmer_locs", check_xmer_locs },
+    { "id_sets",   check_id_sets },
+    { "libraries", check_libraries }
+};
+#define NUM_CHECKS ( sizeof( CHECKS ) / sizeof( CHECKS[ 0 ] ) )
+
+static const struct option LONG_OPTIONS[] =
+{
+    { "engines", required_argument, NULL, 'e' },
+    { "trials",  required_argument, NULL, 'n' },
+    { "seed",    required_argument, NULL, 'S' },
+    { NULL, 0, NULL, 0 }
+};
+
+static uint64_t next_random( uint64_t *state );
+static unsigned int random_below( uint64_t *state, unsigned int bound );
+static void random_matrix( uint64_t *state, blosum_data_t *matrix );
+static hash_table_t *reference_table( sequence_t **seqs, int num_seqs, int window_size );
+static void reference_totals( hash_table_t *target_kmers, sequence_t **oligos,
+                              int num_oligos, int window_size, int num_mismatches,
+                              const blosum_data_t *matrix
+                            );
+static void reference_reduced_totals( hash_table_t *target_kmers, sequence_t **oligos,
+                                      int num_oligos, int window_size
+                                    );
+static void reference_scores( hash_table_t *target_kmers, sequence_t **oligos,
+                              int num_oligos, const match_params_t *params,
+                              reference_t reference, const blosum_data_t *matrix
+                            );
+static bool reference_weight( const char *target, const char *kmer, int window_size,
+                              int num_mismatches, const blosum_data_t *matrix, int *weight
+                            );
+// a position is a mismatch when its pair of residues is missing from
+// the matrix, or when they differ and score below the cutoff
+static bool reference_weight( const char *target, const char *kmer, int window_size,
+                              int num_mismatches, const blosum_data_t *matrix, int *weight
+                            )
+{
+    int mismatches = 0;
+    int distance = 0;
+    int position = 0;
+
+    *weight = 0;
+    for( position = 0; position < window_size; position++ )
+        {
+            distance = get_blosum_dist( (blosum_data_t *) matrix, kmer[ position ],
+                                        target[ position ]
+                                      );
+            if( distance == BLOSUM_DATA_NOT_FOUND )
+                {
+                    mismatches++;
+                    continue;
+                }
+            if( kmer[ position ] != target[ position ] && distance < matrix->cutoff )
+                {
+                    mismatches++;
+                }
+            *weight += distance;
+        }
+    return mismatches <= num_mismatches;
+}
+
+static unsigned int compare_tables( const hash_table_t *expected, hash_table_t *found,
+                                    const char *engine_name, unsigned int trial
+                                  );
+static unsigned int compare_sets( set_t *expected, set_t *found, const char *check_name,
+                                  unsigned int trial, const char *name
+                                );
+static unsigned int compare_id_sets( const id_set_t *expected, const id_set_t *found,
+                                     const char *check_name, unsigned int trial,
+                                     const char *name
+                                   );
+static unsigned int compare_id_strings( set_t *expected, const id_set_t *found,
+                                        string_interner_t *interner, unsigned int trial,
+                                        const char *name
+                                      );
+static void id_set_strings( set_t *out_strings, const id_set_t *ids,
+                            string_interner_t *interner
+                          );
+static void reference_xmer_locs( char *ymer, set_t *out_ymer, hash_table_t *xmer_table,
+                                 int window_size, int step_size,
+                                 const substitution_table_t *substitutions
+                               );
+
+int main( int argc, char **argv )
+{
+    synthetic_params_t synthetic;
+    match_params_t params;
+    run_stats_t stats;
+
+    const engine_t *engines[ NUM_ENGINES ];
+    int num_engines = 0;
+    const check_t *checks[ NUM_CHECKS ];
+    int num_checks = 0;
+    char *engine_list = NULL;
+    char *token = NULL;
+    unsigned int num_trials = 100;
+    uint64_t seed = 1;
+    uint64_t state = 0;
+
+    sequence_t **proteome = NULL;
+    sequence_t **oligos = NULL;
+    sequence_t **designed = NULL;
+    int num_oligos = 0;
+    int num_designed = 0;
+    trial_t trial_inputs;
+    hash_table_t *expected[ NUM_REFERENCES ];
+    int reference = 0;
+    hash_table_t **found = NULL;
+
+    unsigned int trial = 0;
+    unsigned int differences = 0;
+    unsigned int engine_index = 0;
+    unsigned int check_index = 0;
+    int option = 0;
+    int index = 0;
+    char *residues = NULL;
+    unsigned int length = 0;
+    unsigned int period = 0;
+
+    while( ( option = getopt_long( argc, argv, "e:n:S:", LONG_OPTIONS, NULL ) ) != -1 )
+        {
+            switch( option )
+                {
+                case 'e':
+                    engine_list = optarg;
+                    break;
+                case 'n':
+                    num_trials = atoi( optarg );
+                    break;
+                case 'S':
+                    seed = strtoull( optarg, NULL, 10 );
+                    break;
+                default:
+                    printf( "USAGE: kmer_oracle [-e engine[,engine...]] [-n trials] [-S seed]\n" );
+                    return EXIT_FAILURE;
+                }
+        }
+
+    for( engine_index = 0; !engine_list && engine_index < NUM_ENGINES; engine_index++ )
+        {
+            engines[ num_engines++ ] = &ENGINES[ engine_index ];
+        }
+    for( check_index = 0; !engine_list && check_index < NUM_CHECKS; check_index++ )
+        {
+            checks[ num_checks++ ] = &CHECKS[ check_index ];
+        }
+    for( token = engine_list ? strtok( engine_list, "," ) : NULL; token;
+         token = strtok( NULL, "," )
+       )
+        {
+            for( engine_index = 0; engine_index < NUM_ENGINES; engine_index++ )
+                {
+                    if( !strcmp( token, ENGINES[ engine_index ].name ) )
+                        {
+                            break;
+                        }
+                }
+            for( check_index = 0; check_index < NUM_CHECKS; check_index++ )
+                {
+                    if( !strcmp( token, CHECKS[ check_index ].name ) )
+                        {
+                            break;
+                        }
+                }
+            if( engine_index < NUM_ENGINES && num_engines < (int) NUM_ENGINES )
+                {
+                    engines[ num_engines++ ] = &ENGINES[ engine_index ];
+                }
+            else if( check_index < NUM_CHECKS && num_checks < (int) NUM_CHECKS )
+                {
+                    checks[ num_checks++ ] = &CHECKS[ check_index ];
+                }
+            else
+                {
+                    printf( "Unknown engine %s\n", token );
+                    return EXIT_FAILURE;
+                }
+        }
+
+    // a level the cpu lacks runs as the best one it has
+    printf( "The cpu supports %s kernels\n", cpu_level_name( cpu_detect_level() ) );
+
+    state = seed ? seed : 1;
+    for( trial = 0; trial < num_trials; trial++ )
+        {
+            // small inputs with short proteins, X runs and near duplicates,
+            // so that every edge case turns up within a few trials
+            synthetic_init( &synthetic );
+            synthetic.seed          = next_random( &state );
+            synthetic.num_proteins  = 1 + random_below( &state, 12 );
+            synthetic.mean_length   = 2 + random_below( &state, 40 );
+            synthetic.redundancy    = random_below( &state, 60 ) / 100.0;
+            synthetic.mutation_rate = random_below( &state, 30 ) / 100.0;
+            synthetic.x_fraction    = random_below( &state, 20 ) / 100.0;
+            synthetic.oligo_length  = 3 + random_below( &state, 20 );
+            synthetic.oligo_step    = 1 + random_below( &state, synthetic.oligo_length );
+
+            stats_init( &stats );
+            memset( &params, 0, sizeof( params ) );
+            params.num_mismatches = random_below( &state, 3 );
+            params.window_size    = 1 + random_below( &state, 8 );
+            params.stats          = &stats;
+
+            proteome = synthetic_proteome( &synthetic );
+
+            // a low complexity protein repeats kmers within one oligo
+            residues = proteome[ 0 ]->sequence->data;
+            length = proteome[ 0 ]->sequence->size;
+            period = 1 + random_below( &state, 3 );
+            for( index = period; index < (int) length; index++ )
+                {
+                    residues[ index ] = residues[ index - period ];
+                }
+
+            // tiling the designed proteins twice gives duplicate oligos
+            num_designed = 1 + random_below( &state, synthetic.num_proteins );
+            designed = malloc( 2 * num_designed * sizeof( sequence_t * ) );
+            for( index = 0; index < num_designed; index++ )
+                {
+                    designed[ index ] = proteome[ index ];
+                    designed[ num_designed + index ] = proteome[ index ];
+                }
+            oligos = synthetic_library( designed, num_designed * ( 1 + random_below( &state, 2 ) ),
+                                        &synthetic, &num_oligos
+                                      );
+            free( designed );
+
+            trial_inputs.state = &state;
+            random_matrix( &state, &trial_inputs.matrix );
+
+            for( reference = 0; reference < NUM_REFERENCES; reference++ )
+                {
+                    expected[ reference ] = reference_table( proteome, synthetic.num_proteins,
+                                                             params.window_size
+                                                           );
+                    reference_scores( expected[ reference ], oligos, num_oligos, &params,
+                                      reference, &trial_inputs.matrix
+                                    );
+                }
+
+            for( engine_index = 0; engine_index < (unsigned int) num_engines; engine_index++ )
+                {
+                    kernels_init( cpu_detect_level() );
+                    found = seqs_to_kmer_tables( proteome, synthetic.num_proteins,
+                                                 &params.window_size, 1, &stats
+                                               );
+                    if( found[ 0 ]->size )
+                        {
+                            engines[ engine_index ]->run( found[ 0 ], oligos, num_oligos,
+                                                          &params, &trial_inputs
+                                                        );
+                        }
+                    differences += compare_tables( expected[ engines[ engine_index ]->reference ],
+                                                   found[ 0 ],
+                                                   engines[ engine_index ]->name, trial
+                                                 );
+                    clear_table( found[ 0 ] );
+                    free( found );
+                }
+
+            for( check_index = 0; check_index < (unsigned int) num_checks; check_index++ )
+                {
+                    differences += checks[ check_index ]->run( proteome, synthetic.num_proteins,
+                                                               oligos, num_oligos, &params,
+                                                               &trial_inputs, trial
+                                                             );
+                }
+
+            for( reference = 0; reference < NUM_REFERENCES; reference++ )
+                {
+                    clear_table( expected[ reference ] );
+                }
+            clear_seqs( proteome, synthetic.num_proteins );
+            clear_seqs( oligos, num_oligos );
+            free( proteome );
+            free( oligos );
+        }
+
+    printf( "%u trials of %d engines and %d checks, %u differences from the reference\n",
+            num_trials, num_engines, num_checks, differences
+          );
+    return differences ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// every thread count up to MAX_ORACLE_THREADS, picked at random
+static void run_threads( hash_table_t *target_kmers, sequence_t **oligos, int num_oligos,
+                         const match_params_t *params, trial_t *trial
+                       )
+{
+    int num_threads = 1 + random_below( trial->state, MAX_ORACLE_THREADS );
+    int saved_threads = omp_get_max_threads();
+
+    #ifdef _OPENMP
+    omp_set_num_threads( num_threads );
+    #endif
+    (void) num_threads;
+
+    get_kmer_totals( target_kmers, oligos, NULL, num_oligos, 1, params );
+
+    // later engines and checks run on the thread count they expect
+    #ifdef _OPENMP
+    omp_set_num_threads( saved_threads );
+    #endif
+    (void) saved_threads;
+}
+
+// consecutive ranges of oligos, as checkpoints, resumes and shards count them
+static void run_chunked( hash_table_t *target_kmers, sequence_t **oligos, int num_oligos,
+                         const match_params_t *params, trial_t *trial
+                       )
+{
+    design_libraries_t designs;
+    int first_oligo = 0;
+    int chunk = 0;
+
+    memset( &designs, 0, sizeof( designs ) );
+    designs.num_libraries = 1;
+    designs.oligos = oligos;
+    designs.libraries = calloc( num_oligos, sizeof( unsigned int ) );
+    designs.num_oligos = num_oligos;
+
+    for( first_oligo = 0; first_oligo < num_oligos; first_oligo += chunk )
+        {
+            chunk = 1 + random_below( trial->state, num_oligos - first_oligo );
+            count_oligos( target_kmers, &designs, first_oligo, chunk, false, params );
+        }
+
+    free( designs.libraries );
+}
+
+// substitution scoring with an identity matrix, which allows no
+// substitution, counts exactly the mismatches the reference does
+static void run_substitution( hash_table_t *target_kmers, sequence_t **oligos, int num_oligos,
+                              const match_params_t *params, trial_t *trial
+                            )
+{
+    blosum_data_t blosum;
+    match_params_t substitution_params = *params;
+    int row = 0;
+    int column = 0;
+
+    (void) trial;
+
+    memset( &blosum, 0, sizeof( blosum ) );
+    for( row = 0; row < NUM_RESIDUE_CODES; row++ )
+        {
+            for( column = 0; column < NUM_RESIDUE_CODES; column++ )
+                {
+                    blosum.distances[ row ][ column ] = row == column ? 1 : -1;
+                }
+        }
+    blosum_set_cutoff( &blosum, DEFAULT_BLOSUM_CUTOFF );
+
+    substitution_params.blosum_data = &blosum;
+    get_kmer_totals( target_kmers, oligos, NULL, num_oligos, 1, &substitution_params );
+}
+
+// weighted scoring with the random matrix of the trial
+static void run_weighted( hash_table_t *target_kmers, sequence_t **oligos, int num_oligos,
+                          const match_params_t *params, trial_t *trial
+                        )
+{
+    match_params_t weighted_params = *params;
+
+    weighted_params.blosum_data = &trial->matrix;
+    weighted_params.weighted = true;
+    get_kmer_totals( target_kmers, oligos, NULL, num_oligos, 1, &weighted_params );
+}
+
+// the count_mismatches kernels of one instruction set
+static void run_level( hash_table_t *target_kmers, sequence_t **oligos, int num_oligos,
+                       const match_params_t *params, cpu_level_t level
+                     )
+{
+    kernels_init( level );
+    get_kmer_totals( target_kmers, oligos, NULL, num_oligos, 1, params );
+}
+
+static void run_baseline( hash_table_t *target_kmers, sequence_t **oligos, int num_oligos,
+                          const match_params_t *params, trial_t *trial
+                        )
+{
+    (void) trial;
+    run_level( target_kmers, oligos, num_oligos, params, CPU_LEVEL_BASELINE );
+}
+
+static void run_avx2( hash_table_t *target_kmers, sequence_t **oligos, int num_oligos,
+                      const match_params_t *params, trial_t *trial
+                    )
+{
+    (void) trial;
+    run_level( target_kmers, oligos, num_oligos, params, CPU_LEVEL_AVX2 );
+}
+
+static void run_avx512( hash_table_t *target_kmers, sequence_t **oligos, int num_oligos,
+                        const match_params_t *params, trial_t *trial
+                      )
+{
+    (void) trial;
+    run_level( target_kmers, oligos, num_oligos, params, CPU_LEVEL_AVX512 );
+}
+
+// reduced alphabet matching, against a reference that reduces every
+// target and oligo kmer instead of indexing the reduced targets
+static void run_reduced( hash_table_t *target_kmers, sequence_t **oligos, int num_oligos,
+                         const match_params_t *params, trial_t *trial
+                       )
+{
+    (void) trial;
+    get_reduced_kmer_totals( target_kmers, oligos, NULL, num_oligos, params );
+}
+
+// component_xmer_locs_batch on a random number of threads, against
+// component_xmer_locs one ymer at a time, and the location ids of each
+// ymer against the location strings found by looking its xmers up in the
+// table made by create_xmers_with_locs. Ymers are the oligos, xmers are
+// permuted within functional groups, by the random matrix or not
+static unsigned int check_xmer_locs( sequence_t **proteome, int num_proteins,
+                                     sequence_t **oligos, int num_oligos,
+                                     const match_params_t *params, trial_t *trial,
+                                     unsigned int trial_number
+                                   )
+{
+    hash_table_t xmer_table;
+    hash_table_t xmer_ids;
+    string_interner_t interner;
+    substitution_table_t substitutions;
+    const substitution_table_t *substitutions_ptr = &substitutions;
+    char **ymers = malloc( num_oligos * sizeof( char * ) );
+    id_set_t **batch = malloc( num_oligos * sizeof( id_set_t * ) );
+    id_set_t single;
+    set_t expected;
+    set_t found;
+    HT_Entry **items = NULL;
+    unsigned int differences = 0;
+    unsigned int item_index = 0;
+    int window_size = params->window_size;
+    int step_size = 1 + random_below( trial->state, window_size );
+    int num_threads = 1 + random_below( trial->state, MAX_ORACLE_THREADS );
+    int saved_threads = omp_get_max_threads();
+    int index = 0;
+
+    switch( random_below( trial->state, 3 ) )
+        {
+        case 0:
+            substitutions_ptr = NULL;
+            break;
+        case 1:
+            substitution_table_init( &substitutions, NULL, DEFAULT_BLOSUM_CUTOFF );
+            break;
+        default:
+            substitution_table_init( &substitutions, &trial->matrix, trial->matrix.cutoff );
+            break;
+        }
+
+    ht_init( &xmer_table, 1024 );
+    for( index = 0; index < num_proteins; index++ )
+        {
+            create_xmers_with_locs( &xmer_table, proteome[ index ]->name,
+                                    proteome[ index ]->sequence->data, window_size, 1
+                                  );
+        }
+
+    ht_init( &xmer_ids, 1024 );
+    interner_init( &interner, 1024 );
+    intern_xmer_locs( &xmer_ids, &xmer_table, &interner );
+
+    for( index = 0; index < num_oligos; index++ )
+        {
+            ymers[ index ] = oligos[ index ]->sequence->data;
+            batch[ index ] = malloc( sizeof( id_set_t ) );
+            id_set_init( batch[ index ], 16 );
+        }
+
+    #ifdef _OPENMP
+    omp_set_num_threads( num_threads );
+    #endif
+    (void) num_threads;
+    component_xmer_locs_batch( ymers, num_oligos, batch, &xmer_ids,
+                               window_size, step_size, substitutions_ptr
+                             );
+    #ifdef _OPENMP
+    omp_set_num_threads( saved_threads );
+    #endif
+    (void) saved_threads;
+
+    for( index = 0; index < num_oligos; index++ )
+        {
+            id_set_init( &single, 16 );
+            component_xmer_locs( ymers[ index ], &single, &xmer_ids,
+                                 window_size, step_size, substitutions_ptr
+                               );
+            differences += compare_id_sets( &single, batch[ index ], "xmer_locs",
+                                            trial_number, oligos[ index ]->name
+                                          );
+
+            set_init( &expected, 16 );
+            set_init( &found, 16 );
+            reference_xmer_locs( ymers[ index ], &expected, &xmer_table,
+                                 window_size, step_size, substitutions_ptr
+                               );
+            id_set_strings( &found, &single, &interner );
+            differences += compare_sets( &expected, &found, "xmer_locs", trial_number,
+                                         oligos[ index ]->name
+                                       );
+
+            set_clear( &expected );
+            set_clear( &found );
+            id_set_clear( &single );
+            id_set_clear( batch[ index ] );
+            free( batch[ index ] );
+        }
+
+    items = ht_get_items( &xmer_table );
+    for( item_index = 0; item_index < xmer_table.size; item_index++ )
+        {
+            ar_clear_and_free( items[ item_index ]->value );
+        }
+    free( items );
+    xmer_ids_clear( &xmer_ids );
+    interner_clear( &interner );
+    ht_clear( &xmer_table );
+    free( ymers );
+    free( batch );
+
+    return differences;
+}
+
+// several design libraries counted at once through count_oligos. Each
+// library's scores are checked against a reference over that library's
+// oligos alone, the total against one over every oligo. The scoring is
+// picked at random from the references
+static unsigned int check_libraries( sequence_t **proteome, int num_proteins,
+                                     sequence_t **oligos, int num_oligos,
+                                     const match_params_t *params, trial_t *trial,
+                                     unsigned int trial_number
+                                   )
+{
+    design_libraries_t designs;
+    match_params_t library_params = *params;
+    reference_t reference = random_below( trial->state, NUM_REFERENCES );
+    sequence_t **library_oligos = malloc( num_oligos * sizeof( sequence_t * ) );
+    hash_table_t **found = NULL;
+    hash_table_t *expected = NULL;
+    HT_Entry **items = NULL;
+    const kmer_t *want = NULL;
+    const kmer_t *got = NULL;
+    unsigned int num_libraries = 2 + random_below( trial->state, MAX_ORACLE_LIBRARIES - 1 );
+    unsigned int library = 0;
+    unsigned int differences = 0;
+    unsigned int item_index = 0;
+    int num_library_oligos = 0;
+    int index = 0;
+
+    if( reference == REFERENCE_WEIGHTED )
+        {
+            library_params.blosum_data = &trial->matrix;
+            library_params.weighted = true;
+        }
+
+    // the oligos of each library are consecutive, as read_design_libraries
+    // reads them, and a library may have none
+    memset( &designs, 0, sizeof( designs ) );
+    designs.num_libraries = num_libraries;
+    designs.oligos = oligos;
+    designs.libraries = malloc( num_oligos * sizeof( unsigned int ) );
+    designs.num_oligos = num_oligos;
+    for( index = 0; index < num_oligos; index++ )
+        {
+            if( library + 1 < num_libraries && !random_below( trial->state, 4 ) )
+                {
+                    library++;
+                }
+            designs.libraries[ index ] = library;
+        }
+
+    found = seqs_to_kmer_tables( proteome, num_proteins, &library_params.window_size, 1,
+                                 params->stats
+                               );
+    add_library_scores( found[ 0 ], num_libraries );
+    if( found[ 0 ]->size )
+        {
+            count_oligos( found[ 0 ], &designs, 0, num_oligos,
+                          reference == REFERENCE_REDUCED, &library_params
+                        );
+        }
+
+    // a library of num_libraries stands for every oligo, and the total score
+    for( library = 0; library <= num_libraries; library++ )
+        {
+            num_library_oligos = 0;
+            for( index = 0; index < num_oligos; index++ )
+                {
+                    if( library == num_libraries || designs.libraries[ index ] == library )
+                        {
+                            library_oligos[ num_library_oligos++ ] = oligos[ index ];
+                        }
+                }
+
+            expected = reference_table( proteome, num_proteins, library_params.window_size );
+            reference_scores( expected, library_oligos, num_library_oligos, &library_params,
+                              reference, &trial->matrix
+                            );
+
+            if( library == num_libraries )
+                {
+                    differences += compare_tables( expected, found[ 0 ], "libraries",
+                                                   trial_number
+                                                 );
+                    clear_table( expected );
+                    break;
+                }
+
+            items = ht_get_items( expected );
+            for( item_index = 0; item_index < expected->size; item_index++ )
+                {
+                    want = items[ item_index ]->value;
+                    got = ht_find( found[ 0 ], items[ item_index ]->key );
+                    if( got && library_score( got, library ) != want->kmer_score
+                        && differences++ < MAX_REPORTED_DIFFERENCES
+                      )
+                        {
+                            printf( "trial %u, libraries: %s scored %u in library %u of %u, "
+                                    "expected %u\n", trial_number, items[ item_index ]->key,
+                                    library_score( got, library ), library, num_libraries,
+                                    want->kmer_score
+                                  );
+                        }
+                }
+            free( items );
+            clear_table( expected );
+        }
+
+    clear_table( found[ 0 ] );
+    free( found );
+    free( designs.libraries );
+    free( library_oligos );
+
+    return differences;
+}
+
+// interning, then each id set operation against the same operation on
+// set_t. Strings are short and over a small alphabet, so that the random
+// sets overlap and the strings are interned more than once
+static unsigned int check_id_sets( sequence_t **proteome, int num_proteins,
+                                   sequence_t **oligos, int num_oligos,
+                                   const match_params_t *params, trial_t *trial,
+                                   unsigned int trial_number
+                                 )
+{
+    string_interner_t interner;
+    set_t string_sets[ 2 ];
+    id_set_t id_sets[ 2 ];
+    set_t expected;
+    set_t found;
+    set_t distinct;
+    id_set_t result;
+    char strings[ ID_SET_STRINGS ][ ID_SET_STRING_LENGTH + 1 ];
+    uint32_t ids[ ID_SET_STRINGS ];
+    uint32_t picks[ ID_SET_STRINGS ];
+    uint32_t found_id = 0;
+    unsigned int differences = 0;
+    unsigned int num_picks = 0;
+    int length = 0;
+    int index = 0;
+    int side = 0;
+
+    (void) proteome;
+    (void) num_proteins;
+    (void) oligos;
+    (void) num_oligos;
+    (void) params;
+
+    interner_init( &interner, 16 );
+    set_init( &distinct, ID_SET_STRINGS );
+    for( index = 0; index < ID_SET_STRINGS; index++ )
+        {
+            length = 1 + random_below( trial->state, ID_SET_STRING_LENGTH );
+            strings[ index ][ length ] = '\0';
+            while( length-- )
+                {
+                    strings[ index ][ length ] = "ACGT"[ random_below( trial->state, 4 ) ];
+                }
+            ids[ index ] = intern( &interner, strings[ index ] );
+            set_add( &distinct, strings[ index ] );
+        }
+
+    // ids are dense, stable and name their strings
+    if( interner.strings.size != distinct.data->size )
+        {
+            printf( "trial %u, id_sets: interned %u distinct strings as %u ids\n",
+                    trial_number, distinct.data->size, interner.strings.size
+                  );
+            differences++;
+        }
+    for( index = 0; index < ID_SET_STRINGS; index++ )
+        {
+            if( ( ids[ index ] >= interner.strings.size
+                  || intern( &interner, strings[ index ] ) != ids[ index ]
+                  || !interner_find( &interner, strings[ index ], &found_id )
+                  || found_id != ids[ index ]
+                  || strcmp( interner_string( &interner, ids[ index ] ), strings[ index ] )
+                )
+                && differences++ < MAX_REPORTED_DIFFERENCES
+              )
+                {
+                    printf( "trial %u, id_sets: %s was interned as %u, then %u\n",
+                            trial_number, strings[ index ], ids[ index ],
+                            intern( &interner, strings[ index ] )
+                          );
+                }
+        }
+    if( interner_find( &interner, "N", &found_id ) )
+        {
+            printf( "trial %u, id_sets: found N, which was not interned\n", trial_number );
+            differences++;
+        }
+
+    // the first set is built with id_set_add_all, the second one id at a time
+    for( side = 0; side < 2; side++ )
+        {
+            set_init( &string_sets[ side ], ID_SET_STRINGS );
+            id_set_init( &id_sets[ side ], 0 );
+
+            num_picks = random_below( trial->state, ID_SET_STRINGS + 1 );
+            for( index = 0; index < (int) num_picks; index++ )
+                {
+                    picks[ index ] = random_below( trial->state, ID_SET_STRINGS );
+                    set_add( &string_sets[ side ], strings[ picks[ index ] ] );
+                    picks[ index ] = ids[ picks[ index ] ];
+                    if( side )
+                        {
+                            id_set_add( &id_sets[ side ], picks[ index ] );
+                        }
+                }
+            if( !side )
+                {
+                    id_set_add_all( &id_sets[ side ], picks, num_picks );
+                }
+
+            set_init( &found, 16 );
+            id_set_strings( &found, &id_sets[ side ], &interner );
+            differences += compare_sets( &string_sets[ side ], &found, "id_sets", trial_number,
+                                         side ? "id_set_add" : "id_set_add_all"
+                                       );
+            set_clear( &found );
+        }
+
+    for( index = 0; index < ID_SET_STRINGS; index++ )
+        {
+            if( id_set_check( &id_sets[ 0 ], ids[ index ] )
+                != set_check( &string_sets[ 0 ], strings[ index ] )
+                && differences++ < MAX_REPORTED_DIFFERENCES
+              )
+                {
+                    printf( "trial %u, id_sets: id_set_check of %s disagrees with set_check\n",
+                            trial_number, strings[ index ]
+                          );
+                }
+        }
+
+    set_init( &expected, ID_SET_STRINGS );
+    set_update( &expected, &string_sets[ 0 ] );
+    set_update( &expected, &string_sets[ 1 ] );
+    id_set_init( &result, 0 );
+    id_set_union( &result, &id_sets[ 0 ], &id_sets[ 1 ] );
+    differences += compare_id_strings( &expected, &result, &interner, trial_number,
+                                       "id_set_union"
+                                     );
+    set_clear( &expected );
+
+    set_init( &expected, ID_SET_STRINGS );
+    for( index = 0; index < ID_SET_STRINGS; index++ )
+        {
+            if( set_check( &string_sets[ 0 ], strings[ index ] )
+                && set_check( &string_sets[ 1 ], strings[ index ] )
+              )
+                {
+                    set_add( &expected, strings[ index ] );
+                }
+        }
+    id_set_intersection( &result, &id_sets[ 0 ], &id_sets[ 1 ] );
+    differences += compare_id_strings( &expected, &result, &interner, trial_number,
+                                       "id_set_intersection"
+                                     );
+    set_clear( &expected );
+
+    set_difference( &string_sets[ 0 ], &string_sets[ 1 ] );
+    id_set_difference( &id_sets[ 0 ], &id_sets[ 1 ] );
+    differences += compare_id_strings( &string_sets[ 0 ], &id_sets[ 0 ], &interner,
+                                       trial_number, "id_set_difference"
+                                     );
+
+    for( side = 0; side < 2; side++ )
+        {
+            set_clear( &string_sets[ side ] );
+            id_set_clear( &id_sets[ side ] );
+        }
+    id_set_clear( &result );
+    set_clear( &distinct );
+    interner_clear( &interner );
+
+    return differences;
+}
+
+// xorshift64*, the same generator synthetic.c uses
+static uint64_t next_random( uint64_t *state )
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+static unsigned int random_below( uint64_t *state, unsigned int bound )
+{
+    return bound ? next_random( state ) % bound : 0;
+}
+
+// a symmetric matrix over the synthetic residues, with negative scores
+// below a random cutoff. One residue is left out of half of the matrices,
+// and X is never in them
+static void random_matrix( uint64_t *state, blosum_data_t *matrix )
+{
+    int missing = random_below( state, 2 * NUM_MATRIX_RESIDUES );
+    int row = 0;
+    int column = 0;
+    uint8_t row_code = 0;
+    uint8_t column_code = 0;
+    int distance = 0;
+
+    memset( matrix, 0, sizeof( blosum_data_t ) );
+    memset( matrix->distances, BLOSUM_DATA_NOT_FOUND, sizeof( matrix->distances ) );
+
+    for( row = 0; row < NUM_MATRIX_RESIDUES; row++ )
+        {
+            for( column = row; column < NUM_MATRIX_RESIDUES; column++ )
+                {
+                    distance = row == column ? 1 + (int) random_below( state, 8 )
+                                             : (int) random_below( state, 9 ) - 4;
+                    if( row == missing || column == missing )
+                        {
+                            continue;
+                        }
+                    row_code = residue_to_code( MATRIX_RESIDUES[ row ] );
+                    column_code = residue_to_code( MATRIX_RESIDUES[ column ] );
+                    matrix->distances[ row_code ][ column_code ] = distance;
+                    matrix->distances[ column_code ][ row_code ] = distance;
+                }
+        }
+    blosum_set_cutoff( matrix, (int) random_below( state, 5 ) - 2 );
+}
+
+// every kmer without an X, positioned at its first occurrence
+static hash_table_t *reference_table( sequence_t **seqs, int num_seqs, int window_size )
+{
+    hash_table_t *table = malloc( sizeof( hash_table_t ) );
+    kmer_t *kmer = NULL;
+    char *seq = NULL;
+    char *substr = NULL;
+    int length = 0;
+    int index = 0;
+    int start = 0;
+
+    ht_init( table, 1024 );
+    for( index = 0; index < num_seqs; index++ )
+        {
+            seq = seqs[ index ]->sequence->data;
+            length = strlen( seq );
+            for( start = 0; start + window_size <= length; start++ )
+                {
+                    substr = strndup( seq + start, window_size );
+                    if( strchr( substr, 'X' ) || ht_find( table, substr ) )
+                        {
+                            free( substr );
+                            continue;
+                        }
+
+                    kmer = malloc( sizeof( kmer_t ) );
+                    kmer_init( kmer, substr, start, start + window_size, 0 );
+                    kmer->protein_index = index;
+                    ht_add( table, substr, kmer );
+                }
+        }
+    return table;
+}
+
+// one point for each distinct kmer of each oligo within num_mismatches,
+// scored by the brute force get_mismatch_counts. With a matrix, each
+// match adds its summed substitution score instead, when it is positive
+static void reference_totals( hash_table_t *target_kmers, sequence_t **oligos,
+                              int num_oligos, int window_size, int num_mismatches,
+                              const blosum_data_t *matrix
+                            )
+{
+    hash_table_t distinct;
+    HT_Entry **items = ht_get_items( target_kmers );
+    HT_Entry **oligo_items = NULL;
+    item_scores_t scores;
+    char *seq = NULL;
+    char *substr = NULL;
+    int length = 0;
+    int index = 0;
+    int start = 0;
+    unsigned int kmer_index = 0;
+    unsigned int item_index = 0;
+    int weight = 0;
+
+    item_scores_init( &scores, target_kmers->size, 1 );
+    for( index = 0; index < num_oligos && target_kmers->size; index++ )
+        {
+            seq = oligos[ index ]->sequence->data;
+            length = strlen( seq );
+
+            ht_init( &distinct, length > 0 ? length : 1 );
+            for( start = 0; start + window_size <= length; start++ )
+                {
+                    substr = strndup( seq + start, window_size );
+                    if( !ht_find( &distinct, substr ) )
+                        {
+                            ht_add( &distinct, substr, target_kmers );
+                        }
+                    free( substr );
+                }
+
+            oligo_items = ht_get_items( &distinct );
+            for( kmer_index = 0; kmer_index < distinct.size && !matrix; kmer_index++ )
+                {
+                    get_mismatch_counts( &scores, items, oligo_items[ kmer_index ]->key,
+                                         target_kmers->size, num_mismatches, 0
+                                       );
+                }
+            for( kmer_index = 0; kmer_index < distinct.size && matrix; kmer_index++ )
+                {
+                    for( item_index = 0; item_index < target_kmers->size; item_index++ )
+                        {
+                            if( reference_weight( items[ item_index ]->key,
+                                                  oligo_items[ kmer_index ]->key, window_size,
+                                                  num_mismatches, matrix, &weight
+                                                )
+                                && weight > 0
+                              )
+                                {
+                                    ( (kmer_t *) items[ item_index ]->value )->kmer_score += weight;
+                                }
+                        }
+                }
+            free( oligo_items );
+            ht_clear( &distinct );
+        }
+    item_scores_add_to( &scores, items, target_kmers->size );
+    item_scores_clear( &scores );
+    free( items );
+}
+
+// one point for each distinct reduced kmer of an oligo that equals the
+// target's own reduced kmer
+static void reference_reduced_totals( hash_table_t *target_kmers, sequence_t **oligos,
+                                      int num_oligos, int window_size
+                                    )
+{
+    hash_table_t distinct;
+    HT_Entry **items = ht_get_items( target_kmers );
+    char reduced[ window_size + 1 ];
+    char *seq = NULL;
+    int length = 0;
+    int index = 0;
+    int start = 0;
+    unsigned int item_index = 0;
+
+    for( index = 0; index < num_oligos && target_kmers->size; index++ )
+        {
+            seq = oligos[ index ]->sequence->data;
+            length = strlen( seq );
+
+            ht_init( &distinct, length > 0 ? length : 1 );
+            for( start = 0; start + window_size <= length; start++ )
+                {
+                    xmer_to_functional_groups( reduced, seq + start, window_size );
+                    if( !ht_find( &distinct, reduced ) )
+                        {
+                            ht_add( &distinct, reduced, target_kmers );
+                        }
+                }
+
+            for( item_index = 0; item_index < target_kmers->size; item_index++ )
+                {
+                    xmer_to_functional_groups( reduced, items[ item_index ]->key, window_size );
+                    if( ht_find( &distinct, reduced ) )
+                        {
+                            ( (kmer_t *) items[ item_index ]->value )->kmer_score++;
+                        }
+                }
+            ht_clear( &distinct );
+        }
+    free( items );
+}
+
+static void reference_scores( hash_table_t *target_kmers, sequence_t **oligos,
+                              int num_oligos, const match_params_t *params,
+                              reference_t reference, const blosum_data_t *matrix
+                            )
+{
+    if( reference == REFERENCE_REDUCED )
+        {
+            reference_reduced_totals( target_kmers, oligos, num_oligos, params->window_size );
+            return;
+        }
+    reference_totals( target_kmers, oligos, num_oligos, params->window_size,
+                      params->num_mismatches,
+                      reference == REFERENCE_WEIGHTED ? matrix : NULL
+                    );
+}
+
+static unsigned int compare_sets( set_t *expected, set_t *found, const char *check_name,
+                                  unsigned int trial, const char *name
+                                )
+{
+    HT_Entry **items = set_get_items( expected );
+    unsigned int index = 0;
+    unsigned int differences = 0;
+
+    if( found->data->size != expected->data->size )
+        {
+            printf( "trial %u, %s: %s has %u members, expected %u\n", trial, check_name,
+                    name, found->data->size, expected->data->size
+                  );
+            differences++;
+        }
+    for( index = 0; index < expected->data->size; index++ )
+        {
+            if( !set_check( found, items[ index ]->key )
+                && differences++ < MAX_REPORTED_DIFFERENCES
+              )
+                {
+                    printf( "trial %u, %s: %s is missing %s\n", trial, check_name, name,
+                            items[ index ]->key
+                          );
+                }
+        }
+    free( items );
+
+    return differences;
+}
+
+static unsigned int compare_id_sets( const id_set_t *expected, const id_set_t *found,
+                                     const char *check_name, unsigned int trial,
+                                     const char *name
+                                   )
+{
+    uint32_t index = 0;
+
+    if( found->size != expected->size )
+        {
+            printf( "trial %u, %s: %s has %u ids, expected %u\n", trial, check_name,
+                    name, found->size, expected->size
+                  );
+            return 1;
+        }
+    // both are sorted, so equal sets are equal arrays
+    for( index = 0; index < expected->size; index++ )
+        {
+            if( found->ids[ index ] != expected->ids[ index ] )
+                {
+                    printf( "trial %u, %s: %s has id %u where %u was expected\n", trial,
+                            check_name, name, found->ids[ index ], expected->ids[ index ]
+                          );
+                    return 1;
+                }
+        }
+    return 0;
+}
+
+static unsigned int compare_id_strings( set_t *expected, const id_set_t *found,
+                                        string_interner_t *interner, unsigned int trial,
+                                        const char *name
+                                      )
+{
+    set_t found_strings;
+    unsigned int differences = 0;
+
+    set_init( &found_strings, 16 );
+    id_set_strings( &found_strings, found, interner );
+    differences = compare_sets( expected, &found_strings, "id_sets", trial, name );
+    set_clear( &found_strings );
+
+    return differences;
+}
+
+static void id_set_strings( set_t *out_strings, const id_set_t *ids,
+                            string_interner_t *interner
+                          )
+{
+    uint32_t index = 0;
+
+    for( index = 0; index < ids->size; index++ )
+        {
+            set_add( out_strings, interner_string( interner, ids->ids[ index ] ) );
+        }
+}
+
+static void add_xmer( char *xmer, void *xmers )
+{
+    ht_add( xmers, xmer, NULL );
+}
+
+// the location strings of every xmer of ymer, and of their permutations
+static void reference_xmer_locs( char *ymer, set_t *out_ymer, hash_table_t *xmer_table,
+                                 int window_size, int step_size,
+                                 const substitution_table_t *substitutions
+                               )
+{
+    hash_table_t xmers;
+    HT_Entry **items = NULL;
+    array_list_t *locations = NULL;
+    char xmer[ window_size + 1 ];
+    int length = strlen( ymer );
+    int start = 0;
+    unsigned int index = 0;
+
+    ht_init( &xmers, 64 );
+    for( start = 0; start + window_size <= length; start += step_size )
+        {
+            memcpy( xmer, ymer + start, window_size );
+            xmer[ window_size ] = '\0';
+            if( strchr( xmer, 'X' ) )
+                {
+                    continue;
+                }
+
+            add_xmer( xmer, &xmers );
+            if( substitutions )
+                {
+                    visit_xmer_permutations( xmer, window_size, substitutions,
+                                             add_xmer, &xmers
+                                           );
+                }
+        }
+
+    items = ht_get_items( &xmers );
+    for( index = 0; index < xmers.size; index++ )
+        {
+            locations = ht_find( xmer_table, items[ index ]->key );
+            if( locations != NULL )
+                {
+                    set_add_all( out_ymer, (char **) locations->array_data, locations->size );
+                }
+        }
+    free( items );
+    ht_clear( &xmers );
+}
+
+static unsigned int compare_tables( const hash_table_t *expected, hash_table_t *found,
+                                    const char *engine_name, unsigned int trial
+                                  )
+{
+    HT_Entry **items = ht_get_items( (hash_table_t *) expected );
+    const kmer_t *want = NULL;
+    const kmer_t *got = NULL;
+    unsigned int differences = 0;
+    unsigned int index = 0;
+
+    if( found->size != expected->size )
+        {
+            printf( "trial %u, %s: %u target kmers, expected %u\n", trial, engine_name,
+                    found->size, expected->size
+                  );
+            differences++;
+        }
+
+    for( index = 0; index < expected->size; index++ )
+        {
+            want = items[ index ]->value;
+            got = ht_find( found, items[ index ]->key );
+
+            if( got && got->kmer_score == want->kmer_score
+                && got->kmer_start == want->kmer_start && got->kmer_end == want->kmer_end
+              )
+                {
+                    continue;
+                }
+
+            if( differences++ < MAX_REPORTED_DIFFERENCES )
+                {
+                    if( !got )
+                        {
+                            printf( "trial %u, %s: %s is missing\n", trial, engine_name,
+                                    items[ index ]->key
+                                  );
+                        }
+                    else
+                        {
+                            printf( "trial %u, %s: %s scored %u at %u-%u, expected %u at %u-%u\n",
+                                    trial, engine_name, items[ index ]->key, got->kmer_score,
+                                    got->kmer_start, got->kmer_end, want->kmer_score,
+                                    want->kmer_start, want->kmer_end
+                                  );
+                        }
+                }
+        }
+    free( items );
+
+    return differences;
+}
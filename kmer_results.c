@@ -0,0 +1,340 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kmer_results.h"
+
+static char *copy_string( const char *source )
+{
+    char *copy = malloc( strlen( source ) + 1 );
+
+    strcpy( copy, source );
+    return copy;
+}
+
+int write_counted_string( FILE *out_file, const char *to_write )
+{
+    uint32_t length = strlen( to_write );
+
+    return fwrite( &length, sizeof( length ), 1, out_file ) == 1
+           && fwrite( to_write, 1, length, out_file ) == length;
+}
+
+char *read_counted_string( FILE *in_file )
+{
+    uint32_t length = 0;
+    char *read_data = NULL;
+
+    if( fread( &length, sizeof( length ), 1, in_file ) != 1 )
+        {
+            return NULL;
+        }
+
+    read_data = malloc( (size_t) length + 1 );
+    if( fread( read_data, 1, length, in_file ) != length )
+        {
+            free( read_data );
+            return NULL;
+        }
+    read_data[ length ] = '\0';
+    return read_data;
+}
+
+int check_header_sizes( FILE *in_file, uint32_t window_size, uint32_t num_rows,
+                        uint32_t num_score_columns, size_t row_bytes
+                      )
+{
+    long start = ftell( in_file );
+    long end = 0;
+
+    if( window_size == 0 || window_size > MAX_PACKED_KMER_LENGTH
+        || num_score_columns == 0 || start < 0
+        || fseek( in_file, 0, SEEK_END ) != 0
+      )
+        {
+            return 0;
+        }
+
+    end = ftell( in_file );
+    if( end < start || fseek( in_file, start, SEEK_SET ) != 0 )
+        {
+            return 0;
+        }
+
+    // each name takes at least its length, and every row its columns
+    return num_score_columns <= (size_t) ( end - start ) / sizeof( uint32_t )
+           && num_rows <= (size_t) ( end - start ) / row_bytes;
+}
+
+static const char *const SCORE_MODE_NAMES[] =
+{
+    "mismatches", "blosum", "weighted", "reduced alphabet"
+};
+#define NUM_SCORE_MODES ( sizeof( SCORE_MODE_NAMES ) / sizeof( SCORE_MODE_NAMES[ 0 ] ) )
+
+void score_settings_init( score_settings_t *settings, uint32_t mode,
+                          const char *blosum_file, int32_t blosum_cutoff
+                        )
+{
+    settings->mode = mode;
+    settings->blosum_cutoff = blosum_cutoff;
+    settings->blosum_file = copy_string( blosum_file ? blosum_file : "" );
+}
+
+void score_settings_clear( score_settings_t *settings )
+{
+    free( settings->blosum_file );
+    settings->blosum_file = NULL;
+}
+
+int score_settings_equal( const score_settings_t *first, const score_settings_t *second )
+{
+    return first->mode == second->mode
+           && first->blosum_cutoff == second->blosum_cutoff
+           && !strcmp( first->blosum_file, second->blosum_file );
+}
+
+void score_settings_text( char *dest, const score_settings_t *settings )
+{
+    const char *mode_name = settings->mode < NUM_SCORE_MODES
+                            ? SCORE_MODE_NAMES[ settings->mode ] : "unknown";
+
+    if( settings->mode == SCORE_BLOSUM || settings->mode == SCORE_WEIGHTED )
+        {
+            snprintf( dest, SCORE_SETTINGS_TEXT_LENGTH, "%s %s, cutoff %d", mode_name,
+                      settings->blosum_file, settings->blosum_cutoff
+                    );
+            return;
+        }
+    snprintf( dest, SCORE_SETTINGS_TEXT_LENGTH, "%s", mode_name );
+}
+
+void results_init( kmer_results_t *results, uint32_t num_rows,
+                   uint32_t num_score_columns,
+                   uint32_t window_size, uint32_t num_mismatches
+                 )
+{
+    uint32_t index;
+
+    results->window_size       = window_size;
+    results->num_mismatches    = num_mismatches;
+    results->num_rows          = num_rows;
+    results->num_score_columns = num_score_columns;
+
+    score_settings_init( &results->scoring, SCORE_MISMATCHES, NULL, 0 );
+    results->reference_file = copy_string( "" );
+    results->design_files   = malloc( num_score_columns * sizeof( char* ) );
+    for( index = 0; index < num_score_columns; index++ )
+        {
+            results->design_files[ index ] = copy_string( "" );
+        }
+
+    results->codes  = calloc( num_rows, sizeof( kmer_code_t ) );
+    results->scores = calloc( (size_t) num_rows * num_score_columns, sizeof( uint32_t ) );
+    results->starts = calloc( num_rows, sizeof( uint32_t ) );
+    results->ends   = calloc( num_rows, sizeof( uint32_t ) );
+}
+
+void results_clear( kmer_results_t *results )
+{
+    uint32_t index;
+
+    for( index = 0; index < results->num_score_columns; index++ )
+        {
+            free( results->design_files[ index ] );
+        }
+    free( results->design_files );
+    free( results->reference_file );
+    score_settings_clear( &results->scoring );
+
+    free( results->codes );
+    free( results->scores );
+    free( results->starts );
+    free( results->ends );
+}
+
+void results_set_inputs( kmer_results_t *results, const char *reference_file,
+                         char **design_files
+                       )
+{
+    uint32_t index;
+
+    free( results->reference_file );
+    results->reference_file = copy_string( reference_file );
+
+    for( index = 0; index < results->num_score_columns; index++ )
+        {
+            free( results->design_files[ index ] );
+            results->design_files[ index ] = copy_string( design_files[ index ] );
+        }
+}
+
+void results_set_scoring( kmer_results_t *results, const score_settings_t *scoring )
+{
+    score_settings_clear( &results->scoring );
+    score_settings_init( &results->scoring, scoring->mode, scoring->blosum_file,
+                         scoring->blosum_cutoff
+                       );
+}
+
+uint32_t *results_column( kmer_results_t *results, uint32_t column )
+{
+    return results->scores + ( (size_t) column * results->num_rows );
+}
+
+int results_write( kmer_results_t *results, const char *file_name )
+{
+    FILE *out_file = fopen( file_name, "wb" );
+    uint32_t version = RESULTS_VERSION;
+    uint32_t index;
+    size_t num_rows = results->num_rows;
+    size_t num_scores = num_rows * results->num_score_columns;
+    int success = 0;
+
+    if( !out_file )
+        {
+            return 0;
+        }
+
+    success = fwrite( RESULTS_MAGIC, 1, RESULTS_MAGIC_LENGTH, out_file ) == RESULTS_MAGIC_LENGTH
+              && fwrite( &version, sizeof( version ), 1, out_file ) == 1
+              && fwrite( &results->window_size, sizeof( uint32_t ), 1, out_file ) == 1
+              && fwrite( &results->num_mismatches, sizeof( uint32_t ), 1, out_file ) == 1
+              && fwrite( &results->num_rows, sizeof( uint32_t ), 1, out_file ) == 1
+              && fwrite( &results->num_score_columns, sizeof( uint32_t ), 1, out_file ) == 1
+              && fwrite( &results->scoring.mode, sizeof( uint32_t ), 1, out_file ) == 1
+              && fwrite( &results->scoring.blosum_cutoff, sizeof( int32_t ), 1, out_file ) == 1
+              && write_counted_string( out_file, results->scoring.blosum_file )
+              && write_counted_string( out_file, results->reference_file );
+
+    for( index = 0; success && index < results->num_score_columns; index++ )
+        {
+            success = write_counted_string( out_file, results->design_files[ index ] );
+        }
+
+    success = success
+              && fwrite( results->codes, sizeof( kmer_code_t ), num_rows, out_file ) == num_rows
+              && fwrite( results->scores, sizeof( uint32_t ), num_scores, out_file ) == num_scores
+              && fwrite( results->starts, sizeof( uint32_t ), num_rows, out_file ) == num_rows
+              && fwrite( results->ends, sizeof( uint32_t ), num_rows, out_file ) == num_rows;
+
+    return fclose( out_file ) == 0 && success;
+}
+
+int results_read( kmer_results_t *results, const char *file_name )
+{
+    FILE *in_file = fopen( file_name, "rb" );
+    char magic[ RESULTS_MAGIC_LENGTH ];
+    uint32_t header[ 5 ];
+    uint32_t score_mode = 0;
+    int32_t blosum_cutoff = 0;
+    uint32_t index;
+    char *read_name = NULL;
+    size_t num_rows;
+    size_t num_scores;
+    int success = 0;
+
+    if( !in_file )
+        {
+            return 0;
+        }
+
+    // version, window size, mismatches, rows, score columns
+    if( fread( magic, 1, RESULTS_MAGIC_LENGTH, in_file ) != RESULTS_MAGIC_LENGTH
+        || memcmp( magic, RESULTS_MAGIC, RESULTS_MAGIC_LENGTH ) != 0
+        || fread( header, sizeof( uint32_t ), 5, in_file ) != 5
+        || header[ 0 ] != RESULTS_VERSION
+        || !check_header_sizes( in_file, header[ 1 ], header[ 3 ], header[ 4 ],
+                                sizeof( kmer_code_t )
+                                + ( (size_t) header[ 4 ] + 2 ) * sizeof( uint32_t )
+                              )
+      )
+        {
+            fclose( in_file );
+            return 0;
+        }
+
+    results_init( results, header[ 3 ], header[ 4 ], header[ 1 ], header[ 2 ] );
+    num_rows   = results->num_rows;
+    num_scores = num_rows * results->num_score_columns;
+
+    // score mode, blosum cutoff, blosum file
+    success = fread( &score_mode, sizeof( uint32_t ), 1, in_file ) == 1
+              && fread( &blosum_cutoff, sizeof( int32_t ), 1, in_file ) == 1;
+    read_name = success ? read_counted_string( in_file ) : NULL;
+    success = read_name != NULL;
+    if( success )
+        {
+            score_settings_clear( &results->scoring );
+            score_settings_init( &results->scoring, score_mode, read_name, blosum_cutoff );
+            free( read_name );
+        }
+
+    read_name = success ? read_counted_string( in_file ) : NULL;
+    success = read_name != NULL;
+    if( success )
+        {
+            free( results->reference_file );
+            results->reference_file = read_name;
+        }
+
+    for( index = 0; success && index < results->num_score_columns; index++ )
+        {
+            read_name = read_counted_string( in_file );
+            success = read_name != NULL;
+            if( success )
+                {
+                    free( results->design_files[ index ] );
+                    results->design_files[ index ] = read_name;
+                }
+        }
+
+    success = success
+              && fread( results->codes, sizeof( kmer_code_t ), num_rows, in_file ) == num_rows
+              && fread( results->scores, sizeof( uint32_t ), num_scores, in_file ) == num_scores
+              && fread( results->starts, sizeof( uint32_t ), num_rows, in_file ) == num_rows
+              && fread( results->ends, sizeof( uint32_t ), num_rows, in_file ) == num_rows;
+
+    fclose( in_file );
+
+    if( !success )
+        {
+            results_clear( results );
+        }
+    return success;
+}
+
+int results_write_tsv( kmer_results_t *results, FILE *out_file )
+{
+    uint32_t row;
+    uint32_t column;
+    char kmer[ MAX_PACKED_KMER_LENGTH + 1 ];
+
+    fprintf( out_file, "Kmer" );
+    for( column = 0; column < results->num_score_columns; column++ )
+        {
+            if( results->num_score_columns == 1 )
+                {
+                    fprintf( out_file, "\tScore" );
+                }
+            else
+                {
+                    fprintf( out_file, "\tScore_%u", column + 1 );
+                }
+        }
+    fprintf( out_file, "\tStart\tEnd\n" );
+
+    for( row = 0; row < results->num_rows; row++ )
+        {
+            kmer_unpack( results->codes[ row ], results->window_size, kmer );
+            fputs( kmer, out_file );
+
+            for( column = 0; column < results->num_score_columns; column++ )
+                {
+                    fprintf( out_file, "\t%u", results_column( results, column )[ row ] );
+                }
+            fprintf( out_file, "\t%u\t%u\n", results->starts[ row ], results->ends[ row ] );
+        }
+
+    return !ferror( out_file );
+}
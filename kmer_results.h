@@ -0,0 +1,213 @@
+#ifndef KMER_RESULTS_H_INCLUDED
+#define KMER_RESULTS_H_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "kmer_code.h"
+
+#define RESULTS_MAGIC "KMRS"
+#define RESULTS_MAGIC_LENGTH 4
+#define RESULTS_VERSION 2
+
+// how the scores were computed, from the get_kmer_counts options
+typedef enum score_mode
+{
+    // exact residues, within the mismatch budget
+    SCORE_MISMATCHES,
+
+    // -b, substitutions that meet the cutoff are not mismatches
+    SCORE_BLOSUM,
+
+    // -b -w, each match adds its summed substitution scores
+    SCORE_WEIGHTED,
+
+    // -r, reduced alphabet kmers
+    SCORE_REDUCED
+} score_mode_t;
+
+/**
+ * Scoring options results were computed with
+ * Note: blosum_file and blosum_cutoff are only set for SCORE_BLOSUM and
+ *       SCORE_WEIGHTED, otherwise they are "" and 0
+ **/
+typedef struct score_settings_t
+{
+    uint32_t mode;
+    int32_t blosum_cutoff;
+    char *blosum_file;
+} score_settings_t;
+
+// longest description written by score_settings_text
+#define SCORE_SETTINGS_TEXT_LENGTH 256
+
+/**
+ * Scores of target kmers, stored column by column
+ * Note: scores holds num_score_columns columns of num_rows scores each,
+ *       the score of row r in column c is scores[ c * num_rows + r ].
+ *       Column c was produced from design_files[ c ]. A result added to
+ *       a previous one names its designs previous+added-removed, with
+ *       the previous result's own design name first
+ *
+ * On disk, in native byte order:
+ *   magic, version, window_size, num_mismatches, num_rows, num_score_columns,
+ *   score mode, blosum cutoff, blosum file, reference_file and each design
+ *   file as a uint32_t length and characters, then the codes, scores,
+ *   starts and ends columns
+ **/
+typedef struct kmer_results_t
+{
+    uint32_t window_size;
+    uint32_t num_mismatches;
+    uint32_t num_rows;
+    uint32_t num_score_columns;
+
+    score_settings_t scoring;
+
+    char *reference_file;
+    char **design_files;
+
+    kmer_code_t *codes;
+    uint32_t *scores;
+    uint32_t *starts;
+    uint32_t *ends;
+} kmer_results_t;
+
+/**
+ * Initializes a score_settings_t
+ * @param settings pointer to score_settings_t to initialize
+ * @param mode score_mode_t the scores are computed with
+ * @param blosum_file string name of the blosum file, copied, or NULL
+ * @param blosum_cutoff cutoff given with the blosum file
+ **/
+void score_settings_init( score_settings_t *settings, uint32_t mode,
+                          const char *blosum_file, int32_t blosum_cutoff
+                        );
+
+/**
+ * Frees the memory held by a score_settings_t, but not the settings itself
+ * @param settings pointer to score_settings_t to clear
+ **/
+void score_settings_clear( score_settings_t *settings );
+
+/**
+ * Compares two score settings
+ * @returns integer boolean whether scores computed with first and second
+ *          can be combined
+ **/
+int score_settings_equal( const score_settings_t *first, const score_settings_t *second );
+
+/**
+ * Describes score settings for messages, e.g. "blosum file.txt, cutoff 1"
+ * @param dest string of at least SCORE_SETTINGS_TEXT_LENGTH characters
+ * @param settings pointer to score_settings_t to describe
+ **/
+void score_settings_text( char *dest, const score_settings_t *settings );
+
+/**
+ * Writes a string as a uint32_t length and its characters, as results
+ * and checkpoint headers store file names
+ * @param out_file open file to write to
+ * @param to_write string to write
+ * @returns integer boolean success of operation
+ **/
+int write_counted_string( FILE *out_file, const char *to_write );
+
+/**
+ * Reads a string written by write_counted_string
+ * @param in_file open file to read from
+ * @returns the string read, which the caller frees, or NULL on failure
+ **/
+char *read_counted_string( FILE *in_file );
+
+/**
+ * Checks the sizes read from a results or checkpoint header before
+ * anything is allocated from them
+ * Note: The window size must be one that kmer codes can pack, there
+ *       must be at least one score column, and the rest of in_file
+ *       must be able to hold num_rows rows of row_bytes bytes each
+ * @param in_file open file positioned after the header
+ * @param window_size number of residues in each kmer
+ * @param num_rows number of rows the header claims
+ * @param num_score_columns number of score columns the header claims
+ * @param row_bytes number of bytes each row takes on disk
+ * @returns integer boolean true if the sizes are usable
+ **/
+int check_header_sizes( FILE *in_file, uint32_t window_size, uint32_t num_rows,
+                        uint32_t num_score_columns, size_t row_bytes
+                      );
+
+/**
+ * Initializes a kmer_results_t, allocating its columns
+ * Note: Input names are set to empty strings, use results_set_inputs.
+ *       Scoring is set to SCORE_MISMATCHES, use results_set_scoring
+ * @param results pointer to kmer_results_t to initialize
+ * @param num_rows number of kmers to hold
+ * @param num_score_columns number of score columns to hold
+ * @param window_size number of residues in each kmer
+ * @param num_mismatches mismatch budget the scores were computed with
+ **/
+void results_init( kmer_results_t *results, uint32_t num_rows,
+                   uint32_t num_score_columns,
+                   uint32_t window_size, uint32_t num_mismatches
+                 );
+
+/**
+ * Frees all of the memory held by a kmer_results_t, but not the
+ * kmer_results_t itself
+ * @param results pointer to kmer_results_t to clear
+ **/
+void results_clear( kmer_results_t *results );
+
+/**
+ * Records the input files results were computed from
+ * Note: The strings are copied
+ * @param results pointer to kmer_results_t to update
+ * @param reference_file string name of the reference file
+ * @param design_files array of num_score_columns design file names
+ **/
+void results_set_inputs( kmer_results_t *results, const char *reference_file,
+                         char **design_files
+                       );
+
+/**
+ * Records the scoring options results were computed with
+ * @param results pointer to kmer_results_t to update
+ * @param scoring pointer to score_settings_t to copy
+ **/
+void results_set_scoring( kmer_results_t *results, const score_settings_t *scoring );
+
+/**
+ * Gets a pointer to one score column of results
+ * @param results pointer to kmer_results_t to get scores from
+ * @param column index of score column
+ * @returns pointer to num_rows scores
+ **/
+uint32_t *results_column( kmer_results_t *results, uint32_t column );
+
+/**
+ * Writes results to a binary results file
+ * @param results pointer to kmer_results_t to write
+ * @param file_name string name of file to write to
+ * @returns integer boolean success of operation
+ **/
+int results_write( kmer_results_t *results, const char *file_name );
+
+/**
+ * Reads a binary results file written by results_write
+ * Note: results must not be initialized, it is initialized on success
+ * @param results pointer to kmer_results_t to read into
+ * @param file_name string name of file to read
+ * @returns integer boolean success of operation
+ **/
+int results_read( kmer_results_t *results, const char *file_name );
+
+/**
+ * Writes results as tab-separated values, with one header line
+ * @param results pointer to kmer_results_t to write
+ * @param out_file open file to write to
+ * @returns integer boolean success of operation
+ **/
+int results_write_tsv( kmer_results_t *results, FILE *out_file );
+
+#endif
@@ -0,0 +1,390 @@
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "kmer_results.h"
+
+typedef struct merge_row
+{
+    kmer_code_t code;
+    uint32_t input_index;
+    uint32_t row;
+} merge_row_t;
+
+static int convert_to_tsv( int argc, char **argv );
+static int filter_results( int argc, char **argv );
+static int merge_results( int argc, char **argv );
+static int compare_merge_rows( const void *first, const void *second );
+static bool same_run( const kmer_results_t *first, const kmer_results_t *second );
+static uint32_t max_score( kmer_results_t *results, uint32_t row );
+static void copy_row( kmer_results_t *dest, uint32_t dest_row,
+                      kmer_results_t *src, uint32_t src_row
+                    );
+static int write_results_as( kmer_results_t *results, const char *file_name, bool as_tsv );
+static void print_usage( void );
+
+int main( int argc, char **argv )
+{
+    if( argc < 2 )
+        {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+
+    if( !strcmp( argv[ 1 ], "tsv" ) )
+        {
+            return convert_to_tsv( argc - 1, argv + 1 );
+        }
+    if( !strcmp( argv[ 1 ], "filter" ) )
+        {
+            return filter_results( argc - 1, argv + 1 );
+        }
+    if( !strcmp( argv[ 1 ], "merge" ) )
+        {
+            return merge_results( argc - 1, argv + 1 );
+        }
+
+    print_usage();
+    return EXIT_FAILURE;
+}
+
+static void print_usage( void )
+{
+    printf( "USAGE: kmer_results tsv in_file [out_file]\n"
+            "       kmer_results filter [-m min_score] [-M max_score] [-t] in_file out_file\n"
+            "       kmer_results merge [-t] out_file in_file...\n"
+          );
+}
+
+static int convert_to_tsv( int argc, char **argv )
+{
+    kmer_results_t results;
+    FILE *out_file = stdout;
+    int success = 0;
+
+    if( argc != 2 && argc != 3 )
+        {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+
+    if( !results_read( &results, argv[ 1 ] ) )
+        {
+            printf( "Unable to read results file %s\n", argv[ 1 ] );
+            return EXIT_FAILURE;
+        }
+
+    if( argc == 3 )
+        {
+            out_file = fopen( argv[ 2 ], "w" );
+            if( !out_file )
+                {
+                    printf( "Unable to open file %s for output.\n", argv[ 2 ] );
+                    results_clear( &results );
+                    return EXIT_FAILURE;
+                }
+        }
+
+    success = results_write_tsv( &results, out_file );
+
+    if( out_file != stdout )
+        {
+            success = fclose( out_file ) == 0 && success;
+        }
+    results_clear( &results );
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int filter_results( int argc, char **argv )
+{
+    kmer_results_t results;
+    kmer_results_t filtered;
+    uint32_t min_score = 0;
+    uint32_t max_allowed = UINT32_MAX;
+    uint32_t row = 0;
+    uint32_t num_kept = 0;
+    uint32_t score = 0;
+    bool as_tsv = false;
+    int option = 0;
+    int success = 0;
+
+    while( ( option = getopt( argc, argv, "m:M:t" ) ) != -1 )
+        {
+            switch( option )
+                {
+                case 'm':
+                    min_score = strtoul( optarg, NULL, 10 );
+                    break;
+                case 'M':
+                    max_allowed = strtoul( optarg, NULL, 10 );
+                    break;
+                case 't':
+                    as_tsv = true;
+                    break;
+                default:
+                    return EXIT_FAILURE;
+                }
+        }
+
+    if( argc - optind != 2 )
+        {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+
+    if( !results_read( &results, argv[ optind ] ) )
+        {
+            printf( "Unable to read results file %s\n", argv[ optind ] );
+            return EXIT_FAILURE;
+        }
+
+    for( row = 0; row < results.num_rows; row++ )
+        {
+            score = max_score( &results, row );
+            num_kept += score >= min_score && score <= max_allowed;
+        }
+
+    results_init( &filtered, num_kept, results.num_score_columns,
+                  results.window_size, results.num_mismatches
+                );
+    results_set_inputs( &filtered, results.reference_file, results.design_files );
+    results_set_scoring( &filtered, &results.scoring );
+
+    num_kept = 0;
+    for( row = 0; row < results.num_rows; row++ )
+        {
+            score = max_score( &results, row );
+            if( score >= min_score && score <= max_allowed )
+                {
+                    copy_row( &filtered, num_kept++, &results, row );
+                }
+        }
+
+    success = write_results_as( &filtered, argv[ optind + 1 ], as_tsv );
+
+    results_clear( &filtered );
+    results_clear( &results );
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int merge_results( int argc, char **argv )
+{
+    int num_inputs = 0;
+    int input_index = 0;
+    int option = 0;
+    bool as_tsv = false;
+    int success = 0;
+
+    kmer_results_t *inputs = NULL;
+    kmer_results_t merged;
+    merge_row_t *rows = NULL;
+
+    uint32_t row = 0;
+    uint32_t column = 0;
+    uint32_t num_rows = 0;
+    uint32_t num_unique = 0;
+    kmer_results_t *source = NULL;
+
+    while( ( option = getopt( argc, argv, "t" ) ) != -1 )
+        {
+            switch( option )
+                {
+                case 't':
+                    as_tsv = true;
+                    break;
+                default:
+                    return EXIT_FAILURE;
+                }
+        }
+
+    num_inputs = argc - optind - 1;
+    if( num_inputs < 1 )
+        {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+
+    inputs = malloc( num_inputs * sizeof( kmer_results_t ) );
+
+    for( input_index = 0; input_index < num_inputs; input_index++ )
+        {
+            if( !results_read( &inputs[ input_index ], argv[ optind + 1 + input_index ] ) )
+                {
+                    printf( "Unable to read results file %s\n", argv[ optind + 1 + input_index ] );
+                    break;
+                }
+            if( !same_run( &inputs[ input_index ], &inputs[ 0 ] ) )
+                {
+                    printf( "Results file %s does not match the window size, mismatches, "
+                            "scoring, reference and design files of %s\n",
+                            argv[ optind + 1 + input_index ], argv[ optind + 1 ]
+                          );
+                    results_clear( &inputs[ input_index ] );
+                    break;
+                }
+            num_rows += inputs[ input_index ].num_rows;
+        }
+
+    if( input_index == num_inputs )
+        {
+            // sort every row by kmer, ties keep their input order so that the
+            // first input a kmer appears in supplies its start and end
+            rows = malloc( num_rows * sizeof( merge_row_t ) );
+            num_rows = 0;
+            for( input_index = 0; input_index < num_inputs; input_index++ )
+                {
+                    for( row = 0; row < inputs[ input_index ].num_rows; row++ )
+                        {
+                            rows[ num_rows ].code        = inputs[ input_index ].codes[ row ];
+                            rows[ num_rows ].input_index = input_index;
+                            rows[ num_rows ].row         = row;
+                            num_rows++;
+                        }
+                }
+            qsort( rows, num_rows, sizeof( merge_row_t ), compare_merge_rows );
+
+            for( row = 0; row < num_rows; row++ )
+                {
+                    num_unique += row == 0 || rows[ row ].code != rows[ row - 1 ].code;
+                }
+
+            results_init( &merged, num_unique, inputs[ 0 ].num_score_columns,
+                          inputs[ 0 ].window_size, inputs[ 0 ].num_mismatches
+                        );
+            results_set_inputs( &merged, inputs[ 0 ].reference_file, inputs[ 0 ].design_files );
+            results_set_scoring( &merged, &inputs[ 0 ].scoring );
+
+            num_unique = 0;
+            for( row = 0; row < num_rows; row++ )
+                {
+                    source = &inputs[ rows[ row ].input_index ];
+
+                    if( row == 0 || rows[ row ].code != rows[ row - 1 ].code )
+                        {
+                            copy_row( &merged, num_unique++, source, rows[ row ].row );
+                            continue;
+                        }
+
+                    for( column = 0; column < merged.num_score_columns; column++ )
+                        {
+                            results_column( &merged, column )[ num_unique - 1 ] +=
+                                results_column( source, column )[ rows[ row ].row ];
+                        }
+                }
+
+            success = write_results_as( &merged, argv[ optind ], as_tsv );
+
+            results_clear( &merged );
+            free( rows );
+        }
+
+    while( input_index-- > 0 )
+        {
+            results_clear( &inputs[ input_index ] );
+        }
+    free( inputs );
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Checks that two results count the same design files against the same
+ * reference in the same way, so that their scores can be summed
+ * @returns boolean true if the results can be merged
+ **/
+static bool same_run( const kmer_results_t *first, const kmer_results_t *second )
+{
+    uint32_t column = 0;
+
+    if( first->window_size != second->window_size
+        || first->num_mismatches != second->num_mismatches
+        || first->num_score_columns != second->num_score_columns
+        || !score_settings_equal( &first->scoring, &second->scoring )
+        || strcmp( first->reference_file, second->reference_file )
+      )
+        {
+            return false;
+        }
+
+    for( column = 0; column < first->num_score_columns; column++ )
+        {
+            if( strcmp( first->design_files[ column ], second->design_files[ column ] ) )
+                {
+                    return false;
+                }
+        }
+    return true;
+}
+
+static int compare_merge_rows( const void *first, const void *second )
+{
+    const merge_row_t *first_row  = first;
+    const merge_row_t *second_row = second;
+
+    if( first_row->code != second_row->code )
+        {
+            return first_row->code < second_row->code ? -1 : 1;
+        }
+    if( first_row->input_index != second_row->input_index )
+        {
+            return first_row->input_index < second_row->input_index ? -1 : 1;
+        }
+    return ( first_row->row > second_row->row ) - ( first_row->row < second_row->row );
+}
+
+static uint32_t max_score( kmer_results_t *results, uint32_t row )
+{
+    uint32_t column;
+    uint32_t score = 0;
+    uint32_t best = 0;
+
+    for( column = 0; column < results->num_score_columns; column++ )
+        {
+            score = results_column( results, column )[ row ];
+            best = score > best ? score : best;
+        }
+    return best;
+}
+
+static void copy_row( kmer_results_t *dest, uint32_t dest_row,
+                      kmer_results_t *src, uint32_t src_row
+                    )
+{
+    uint32_t column;
+
+    dest->codes[ dest_row ]  = src->codes[ src_row ];
+    dest->starts[ dest_row ] = src->starts[ src_row ];
+    dest->ends[ dest_row ]   = src->ends[ src_row ];
+
+    for( column = 0; column < dest->num_score_columns; column++ )
+        {
+            results_column( dest, column )[ dest_row ] = results_column( src, column )[ src_row ];
+        }
+}
+
+static int write_results_as( kmer_results_t *results, const char *file_name, bool as_tsv )
+{
+    FILE *out_file = NULL;
+    int success = 0;
+
+    if( !as_tsv )
+        {
+            success = results_write( results, file_name );
+        }
+    else if( ( out_file = fopen( file_name, "w" ) ) != NULL )
+        {
+            success = results_write_tsv( results, out_file );
+            success = fclose( out_file ) == 0 && success;
+        }
+
+    if( !success )
+        {
+            printf( "Failed to write output to %s.\n", file_name );
+        }
+    return success;
+}
@@ -0,0 +1,159 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#include "perf_counters.h"
+
+static const char *EVENT_NAMES[ NUM_PERF_EVENTS ] =
+{
+    "cycles",
+    "instructions",
+    "cache_misses",
+    "branch_misses"
+};
+
+#ifdef __linux__
+static const uint64_t EVENT_CONFIGS[ NUM_PERF_EVENTS ] =
+{
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+static int open_event( perf_event_t event )
+{
+    struct perf_event_attr attr;
+
+    memset( &attr, 0, sizeof( attr ) );
+    attr.size   = sizeof( attr );
+    attr.type   = PERF_TYPE_HARDWARE;
+    attr.config = EVENT_CONFIGS[ event ];
+
+    // user space only, which a perf_event_paranoid of 2 still allows
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // this thread on any cpu
+    return syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 );
+}
+#else
+static int open_event( perf_event_t event )
+{
+    (void) event;
+    return -1;
+}
+#endif
+
+void perf_counters_init( perf_counters_t *counters, int num_threads )
+{
+    int index = 0;
+
+    counters->num_threads = num_threads;
+    counters->events = ( 1u << NUM_PERF_EVENTS ) - 1;
+    counters->fds = malloc( (size_t) num_threads * NUM_PERF_EVENTS * sizeof( int ) );
+
+    for( index = 0; index < num_threads * NUM_PERF_EVENTS; index++ )
+        {
+            counters->fds[ index ] = -1;
+        }
+}
+
+int perf_counters_open_thread( perf_counters_t *counters, int thread )
+{
+    int *fds = counters->fds + thread * NUM_PERF_EVENTS;
+    int event = 0;
+    int num_open = 0;
+
+    if( thread < 0 || thread >= counters->num_threads )
+        {
+            return 0;
+        }
+
+    for( event = 0; event < NUM_PERF_EVENTS; event++ )
+        {
+            fds[ event ] = open_event( event );
+            if( fds[ event ] < 0 )
+                {
+                    #pragma omp atomic
+                    counters->events &= ~( 1u << event );
+                }
+            num_open += fds[ event ] >= 0;
+        }
+    return num_open > 0;
+}
+
+void perf_counters_read_thread( const perf_counters_t *counters, int thread,
+                                uint64_t *counts
+                              )
+{
+    // value, time enabled, time running
+    uint64_t values[ 3 ];
+    int event = 0;
+    int fd = -1;
+
+    for( event = 0; event < NUM_PERF_EVENTS; event++ )
+        {
+            counts[ event ] = 0;
+            if( !counters || thread < 0 || thread >= counters->num_threads )
+                {
+                    continue;
+                }
+
+            fd = counters->fds[ thread * NUM_PERF_EVENTS + event ];
+            if( fd < 0 || read( fd, values, sizeof( values ) ) != sizeof( values ) )
+                {
+                    continue;
+                }
+
+            // an event sharing its counter was only counted while running
+            counts[ event ] = values[ 2 ] && values[ 2 ] < values[ 1 ]
+                              ? (uint64_t) ( (double) values[ 0 ] * values[ 1 ] / values[ 2 ] )
+                              : values[ 0 ];
+        }
+}
+
+void perf_counters_read_all( const perf_counters_t *counters, uint64_t *counts )
+{
+    uint64_t thread_counts[ NUM_PERF_EVENTS ];
+    int thread = 0;
+    int event = 0;
+
+    memset( counts, 0, NUM_PERF_EVENTS * sizeof( uint64_t ) );
+    for( thread = 0; counters && thread < counters->num_threads; thread++ )
+        {
+            perf_counters_read_thread( counters, thread, thread_counts );
+            for( event = 0; event < NUM_PERF_EVENTS; event++ )
+                {
+                    counts[ event ] += thread_counts[ event ];
+                }
+        }
+}
+
+void perf_counters_clear( perf_counters_t *counters )
+{
+    int index = 0;
+
+    for( index = 0; index < counters->num_threads * NUM_PERF_EVENTS; index++ )
+        {
+            if( counters->fds[ index ] >= 0 )
+                {
+                    close( counters->fds[ index ] );
+                }
+        }
+    free( counters->fds );
+    counters->fds = NULL;
+    counters->num_threads = 0;
+}
+
+const char *perf_event_name( perf_event_t event )
+{
+    return EVENT_NAMES[ event ];
+}
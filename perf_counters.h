@@ -0,0 +1,83 @@
+#ifndef PERF_COUNTERS_H_INCLUDED
+#define PERF_COUNTERS_H_INCLUDED
+
+#include <stdint.h>
+
+/**
+ * Hardware events counted for each thread
+ **/
+typedef enum perf_event
+{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_BRANCH_MISSES,
+    NUM_PERF_EVENTS
+} perf_event_t;
+
+/**
+ * Per-thread hardware counters opened with perf_event_open
+ * Note: fds holds NUM_PERF_EVENTS descriptors for each thread, -1 for
+ *       an event the kernel would not count. A descriptor can be read
+ *       from any thread, it gives the count of the thread that opened it
+ **/
+typedef struct perf_counters
+{
+    int *fds;
+    int num_threads;
+
+    // bit e is set when event e could be opened on every thread
+    unsigned int events;
+} perf_counters_t;
+
+/**
+ * Initializes a perf_counters_t with no counters open
+ * @param counters pointer to perf_counters_t to initialize
+ * @param num_threads number of threads to hold counters for
+ **/
+void perf_counters_init( perf_counters_t *counters, int num_threads );
+
+/**
+ * Opens the counters of the calling thread, counting user space only
+ * Note: Events the kernel does not allow or support are left closed,
+ *       and their bit is cleared from counters->events
+ * @param counters pointer to perf_counters_t to open counters in
+ * @param thread index of the calling thread
+ * @returns integer boolean true if any event could be opened
+ **/
+int perf_counters_open_thread( perf_counters_t *counters, int thread );
+
+/**
+ * Reads the counters of one thread
+ * Note: Counts are scaled up when the kernel multiplexed an event.
+ *       Gives zeros for a NULL counters or an event that is not open
+ * @param counters pointer to perf_counters_t to read, may be NULL
+ * @param thread index of the thread to read
+ * @param counts array of NUM_PERF_EVENTS counts to fill
+ **/
+void perf_counters_read_thread( const perf_counters_t *counters, int thread,
+                                uint64_t *counts
+                              );
+
+/**
+ * Reads the counters of every thread, summed
+ * @param counters pointer to perf_counters_t to read, may be NULL
+ * @param counts array of NUM_PERF_EVENTS counts to fill
+ **/
+void perf_counters_read_all( const perf_counters_t *counters, uint64_t *counts );
+
+/**
+ * Closes the counters of every thread and frees the memory held by
+ * counters, but not counters itself
+ * @param counters pointer to perf_counters_t to clear
+ **/
+void perf_counters_clear( perf_counters_t *counters );
+
+/**
+ * Gets the name of an event
+ * @param event perf_event_t event to name
+ * @returns string name of the event
+ **/
+const char *perf_event_name( perf_event_t event );
+
+#endif
@@ -0,0 +1,442 @@
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash_table.h"
+#include "array_list.h"
+#include "set.h"
+#include "id_set.h"
+#include "dynamic_string.h"
+#include "run_stats.h"
+
+// most key counts and load factors one run accepts
+#define MAX_BENCH_SIZES 16
+
+// length of the generated keys, a default kmer
+#define KEY_LENGTH 9
+
+// residues appended by each ds_add, one fasta line
+#define APPEND_LENGTH 60
+
+// ds_add chains are quadratic, so they are limited to this many appends
+#define MAX_APPENDS 20000
+
+static const char KEY_RESIDUES[] = "ACDEFGHIKLMNPQRSTVWY";
+#define NUM_KEY_RESIDUES 20
+
+// keys are distinct while their index is below 20^9
+#define KEY_SPACE 512000000000ULL
+
+// time and allocations of one run of a primitive over ops operations
+typedef struct bench_case
+{
+    const char *name;
+    double seconds;
+    unsigned long allocations;
+    unsigned long ops;
+} bench_case_t;
+
+static const struct option LONG_OPTIONS[] =
+{
+    { "keys",    required_argument, NULL, 'k' },
+    { "loads",   required_argument, NULL, 'l' },
+    { "repeats", required_argument, NULL, 'n' },
+    { "kmers",   no_argument,       NULL, 'K' },
+    { NULL, 0, NULL, 0 }
+};
+
+// calls to malloc, calloc and realloc, counted when linked with --wrap
+static unsigned long num_allocations = 0;
+
+// hash tables are made with ht_init_kmers, hashing keys as packed kmers
+static bool kmer_tables = false;
+
+void *__real_malloc( size_t size );
+void *__real_calloc( size_t count, size_t size );
+void *__real_realloc( void *data, size_t size );
+
+void *__wrap_malloc( size_t size )
+{
+    num_allocations++;
+    return __real_malloc( size );
+}
+
+void *__wrap_calloc( size_t count, size_t size )
+{
+    num_allocations++;
+    return __real_calloc( count, size );
+}
+
+void *__wrap_realloc( void *data, size_t size )
+{
+    num_allocations++;
+    return __real_realloc( data, size );
+}
+
+static char **make_keys( unsigned long first, unsigned long num_keys );
+static void free_keys( char **keys, unsigned long num_keys );
+static void start_case( bench_case_t *bench, const char *name, unsigned long ops );
+static void end_case( bench_case_t *bench, double start, unsigned long start_allocations,
+                      bench_case_t *best
+                    );
+static void print_case( const bench_case_t *bench, unsigned long num_keys, double load );
+static void bench_hash_table( char **keys, char **missing, unsigned long num_keys,
+                              double load, int repeats
+                            );
+static void bench_containers( char **keys, unsigned long num_keys, int repeats );
+
+int main( int argc, char **argv )
+{
+    unsigned long key_counts[ MAX_BENCH_SIZES ] = { 10000, 100000, 1000000 };
+    double loads[ MAX_BENCH_SIZES ] = { 0.5, 1, 4 };
+    int num_key_counts = 3;
+    int num_loads = 3;
+    int repeats = 3;
+    char *token = NULL;
+    char **keys = NULL;
+    char **missing = NULL;
+    int option = 0;
+    int size_index = 0;
+    int load_index = 0;
+
+    while( ( option = getopt_long( argc, argv, "k:l:n:K", LONG_OPTIONS, NULL ) ) != -1 )
+        {
+            switch( option )
+                {
+                case 'k':
+                    num_key_counts = 0;
+                    for( token = strtok( optarg, "," ); token && num_key_counts < MAX_BENCH_SIZES;
+                         token = strtok( NULL, "," )
+                       )
+                        {
+                            key_counts[ num_key_counts++ ] = strtoul( token, NULL, 10 );
+                        }
+                    break;
+                case 'l':
+                    num_loads = 0;
+                    for( token = strtok( optarg, "," ); token && num_loads < MAX_BENCH_SIZES;
+                         token = strtok( NULL, "," )
+                       )
+                        {
+                            loads[ num_loads++ ] = atof( token );
+                        }
+                    break;
+                case 'n':
+                    repeats = atoi( optarg );
+                    break;
+                case 'K':
+                    kmer_tables = true;
+                    break;
+                default:
+                    printf( "USAGE: primitive_bench [-k keys[,keys...]] [-l load[,load...]] "
+                            "[-n repeats] [-K]\n"
+                          );
+                    return EXIT_FAILURE;
+                }
+        }
+
+    for( size_index = 0; size_index < num_key_counts; size_index++ )
+        {
+            if( !key_counts[ size_index ] )
+                {
+                    printf( "Invalid key count\n" );
+                    return EXIT_FAILURE;
+                }
+        }
+    for( load_index = 0; load_index < num_loads; load_index++ )
+        {
+            if( loads[ load_index ] <= 0 )
+                {
+                    printf( "Invalid load factor\n" );
+                    return EXIT_FAILURE;
+                }
+        }
+    if( repeats < 1 )
+        {
+            printf( "Invalid repeats\n" );
+            return EXIT_FAILURE;
+        }
+
+    printf( "%-18s %10s %8s %12s %10s\n", "primitive", "keys", "load", "ns/op", "allocs/op" );
+    for( size_index = 0; size_index < num_key_counts; size_index++ )
+        {
+            keys    = make_keys( 0, key_counts[ size_index ] );
+            missing = make_keys( key_counts[ size_index ], key_counts[ size_index ] );
+
+            for( load_index = 0; load_index < num_loads; load_index++ )
+                {
+                    bench_hash_table( keys, missing, key_counts[ size_index ],
+                                      loads[ load_index ], repeats
+                                    );
+                }
+            bench_containers( keys, key_counts[ size_index ], repeats );
+
+            free_keys( keys, key_counts[ size_index ] );
+            free_keys( missing, key_counts[ size_index ] );
+        }
+
+    return EXIT_SUCCESS;
+}
+
+// distinct random looking kmers, key i is the base 20 digits of a
+// multiple of i, which is a bijection because the multiplier is odd
+// and not a multiple of 5
+static char **make_keys( unsigned long first, unsigned long num_keys )
+{
+    char **keys = malloc( num_keys * sizeof( char * ) );
+    unsigned long long value = 0;
+    unsigned long index = 0;
+    int position = 0;
+
+    for( index = 0; index < num_keys; index++ )
+        {
+            value = ( ( first + index ) * 2654435761ULL ) % KEY_SPACE;
+            keys[ index ] = malloc( KEY_LENGTH + 1 );
+            for( position = 0; position < KEY_LENGTH; position++ )
+                {
+                    keys[ index ][ position ] = KEY_RESIDUES[ value % NUM_KEY_RESIDUES ];
+                    value /= NUM_KEY_RESIDUES;
+                }
+            keys[ index ][ KEY_LENGTH ] = '\0';
+        }
+    return keys;
+}
+
+static void free_keys( char **keys, unsigned long num_keys )
+{
+    unsigned long index = 0;
+
+    for( index = 0; index < num_keys; index++ )
+        {
+            free( keys[ index ] );
+        }
+    free( keys );
+}
+
+static void start_case( bench_case_t *bench, const char *name, unsigned long ops )
+{
+    bench->name = name;
+    bench->ops = ops;
+}
+
+// keeps the fastest repeat in best, allocations are the same every repeat
+static void end_case( bench_case_t *bench, double start, unsigned long start_allocations,
+                      bench_case_t *best
+                    )
+{
+    bench->seconds = stats_time() - start;
+    bench->allocations = num_allocations - start_allocations;
+
+    if( !best->name || bench->seconds < best->seconds )
+        {
+            *best = *bench;
+        }
+}
+
+static void print_case( const bench_case_t *bench, unsigned long num_keys, double load )
+{
+    char load_text[ 16 ] = "-";
+
+    if( load > 0 )
+        {
+            snprintf( load_text, sizeof( load_text ), "%.2f", load );
+        }
+    printf( "%-18s %10lu %8s %12.1f %10.2f\n", bench->name, num_keys, load_text,
+            bench->ops ? bench->seconds * 1e9 / bench->ops : 0,
+            bench->ops ? (double) bench->allocations / bench->ops : 0
+          );
+}
+
+static void bench_hash_table( char **keys, char **missing, unsigned long num_keys,
+                              double load, int repeats
+                            )
+{
+    // add, find, find a missing key, get_items and delete
+    bench_case_t best[ 5 ];
+    bench_case_t bench;
+    hash_table_t table;
+    HT_Entry **items = NULL;
+    unsigned long index = 0;
+    unsigned long found = 0;
+    unsigned long start_allocations = 0;
+    unsigned int capacity = num_keys / load > 1 ? num_keys / load : 1;
+    double start = 0;
+    int repeat = 0;
+    int primitive = 0;
+
+    memset( best, 0, sizeof( best ) );
+    for( repeat = 0; repeat < repeats; repeat++ )
+        {
+            if( kmer_tables )
+                {
+                    ht_init_kmers( &table, capacity, KEY_LENGTH );
+                }
+            else
+                {
+                    ht_init( &table, capacity );
+                }
+
+            start_case( &bench, "ht_add", num_keys );
+            start_allocations = num_allocations;
+            start = stats_time();
+            for( index = 0; index < num_keys; index++ )
+                {
+                    ht_add( &table, keys[ index ], keys[ index ] );
+                }
+            end_case( &bench, start, start_allocations, &best[ 0 ] );
+
+            start_case( &bench, "ht_find", num_keys );
+            start_allocations = num_allocations;
+            start = stats_time();
+            for( index = 0; index < num_keys; index++ )
+                {
+                    found += ht_find( &table, keys[ index ] ) != NULL;
+                }
+            end_case( &bench, start, start_allocations, &best[ 1 ] );
+
+            start_case( &bench, "ht_find_missing", num_keys );
+            start_allocations = num_allocations;
+            start = stats_time();
+            for( index = 0; index < num_keys; index++ )
+                {
+                    found += ht_find( &table, missing[ index ] ) != NULL;
+                }
+            end_case( &bench, start, start_allocations, &best[ 2 ] );
+
+            // per item, the array is one allocation
+            start_case( &bench, "ht_get_items", table.size );
+            start_allocations = num_allocations;
+            start = stats_time();
+            items = ht_get_items( &table );
+            end_case( &bench, start, start_allocations, &best[ 3 ] );
+            free( items );
+
+            start_case( &bench, "ht_delete", num_keys );
+            start_allocations = num_allocations;
+            start = stats_time();
+            for( index = 0; index < num_keys; index++ )
+                {
+                    ht_delete( &table, keys[ index ] );
+                }
+            end_case( &bench, start, start_allocations, &best[ 4 ] );
+
+            ht_clear( &table );
+        }
+
+    if( found != (unsigned long) repeats * num_keys )
+        {
+            printf( "ht_find found %lu of %lu keys\n", found, (unsigned long) repeats * num_keys );
+        }
+    for( primitive = 0; primitive < 5; primitive++ )
+        {
+            print_case( &best[ primitive ], num_keys, load );
+        }
+}
+
+static void bench_containers( char **keys, unsigned long num_keys, int repeats )
+{
+    // ar_add, set_add_all, set_difference, ds_add, id_set_add_all and id_set_difference
+    bench_case_t best[ 6 ];
+    bench_case_t bench;
+    array_list_t list;
+    set_t first;
+    set_t second;
+    string_interner_t interner;
+    id_set_t first_ids;
+    id_set_t second_ids;
+    uint32_t *ids = malloc( num_keys * sizeof( uint32_t ) );
+    dynamic_string_t *string = NULL;
+    char line[ APPEND_LENGTH + 1 ];
+    unsigned long num_appends = num_keys < MAX_APPENDS ? num_keys : MAX_APPENDS;
+    unsigned long index = 0;
+    unsigned long start_allocations = 0;
+    double start = 0;
+    int repeat = 0;
+    int primitive = 0;
+
+    memset( line, 'A', APPEND_LENGTH );
+    line[ APPEND_LENGTH ] = '\0';
+
+    // keys are interned once, as intern_xmer_locs interns locations up front
+    interner_init( &interner, num_keys );
+    for( index = 0; index < num_keys; index++ )
+        {
+            ids[ index ] = intern( &interner, keys[ index ] );
+        }
+
+    memset( best, 0, sizeof( best ) );
+    for( repeat = 0; repeat < repeats; repeat++ )
+        {
+            ar_init( &list );
+            start_case( &bench, "ar_add", num_keys );
+            start_allocations = num_allocations;
+            start = stats_time();
+            for( index = 0; index < num_keys; index++ )
+                {
+                    ar_add( &list, keys[ index ] );
+                }
+            end_case( &bench, start, start_allocations, &best[ 0 ] );
+            ar_release( &list );
+
+            // sets sized for their keys, as callers size them
+            set_init( &first, num_keys );
+            start_case( &bench, "set_add_all", num_keys );
+            start_allocations = num_allocations;
+            start = stats_time();
+            set_add_all( &first, keys, num_keys );
+            end_case( &bench, start, start_allocations, &best[ 1 ] );
+
+            // half of first is removed, per key of first
+            set_init( &second, num_keys / 2 + 1 );
+            set_add_all( &second, keys, num_keys / 2 );
+            start_case( &bench, "set_difference", num_keys );
+            start_allocations = num_allocations;
+            start = stats_time();
+            set_difference( &first, &second );
+            end_case( &bench, start, start_allocations, &best[ 2 ] );
+            set_clear( &first );
+            set_clear( &second );
+
+            string = malloc( sizeof( dynamic_string_t ) );
+            ds_init( string );
+            start_case( &bench, "ds_add", num_appends );
+            start_allocations = num_allocations;
+            start = stats_time();
+            for( index = 0; index < num_appends; index++ )
+                {
+                    ds_add( string, line );
+                }
+            end_case( &bench, start, start_allocations, &best[ 3 ] );
+            ds_clear( string );
+
+            // the same operations on the interned ids
+            id_set_init( &first_ids, num_keys );
+            start_case( &bench, "id_set_add_all", num_keys );
+            start_allocations = num_allocations;
+            start = stats_time();
+            id_set_add_all( &first_ids, ids, num_keys );
+            end_case( &bench, start, start_allocations, &best[ 4 ] );
+
+            id_set_init( &second_ids, num_keys / 2 + 1 );
+            id_set_add_all( &second_ids, ids, num_keys / 2 );
+            start_case( &bench, "id_set_difference", num_keys );
+            start_allocations = num_allocations;
+            start = stats_time();
+            id_set_difference( &first_ids, &second_ids );
+            end_case( &bench, start, start_allocations, &best[ 5 ] );
+            id_set_clear( &first_ids );
+            id_set_clear( &second_ids );
+        }
+    interner_clear( &interner );
+    free( ids );
+
+    for( primitive = 0; primitive < 6; primitive++ )
+        {
+            print_case( &best[ primitive ],
+                        primitive == 3 ? num_appends : num_keys, 0
+                      );
+        }
+}
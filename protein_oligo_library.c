@@ -12,7 +12,7 @@
 #define LINE_SIZE 512
 #define DASH_CHAR '-'
 #define SPACE ' '
-#define DATA_NOT_FOUND -99
+#define DATA_NOT_FOUND BLOSUM_DATA_NOT_FOUND
 
 // ============== Local Function Prototypes ==================== // 
 
@@ -20,11 +20,27 @@ char get_first_char_in_functional_group( char in_char );
 char get_corresponding_char( char in_char );
 void xmer_first_functional_group( char* in_string, int str_len  );
 int count_letters( char* in_str );
-void get_blosum_distances( hash_table_t* blosum_distance, FILE* blosum_file, int num_rows );
+void get_blosum_distances( blosum_data_t* blosum_data, FILE* blosum_file, int num_rows );
 void get_alpha_chars( char* dest, char* source, int num_chars );
 void get_ints_from_string( int* dest, char* src, int num_rows );
-int get_blosum_dist( blosum_data_t* in_data, char first, char second );
 void write_xmer( char* to_write, char* in_seq, int xmer_index, int window_size, int step_size );
+static void append_permutation( char* permutation, void* permutations );
+static void add_permutation_to_table( char* permutation, void* table );
+static void add_substitution( substitution_table_t* table, int code, char residue );
+static uint32_t allowed_substitutions( const blosum_data_t* blosum_data, int row,
+                                       int blosum_cutoff
+                                     );
+static int num_xmers_in( int length, int window_size, int step_size );
+static int max_permuted_xmers( int num_xmers, int window_size,
+                               const substitution_table_t* substitutions
+                             );
+static void resolve_ymer_locs( char* in_ymer, id_set_t* out_ymer,
+                               hash_table_t* in_xmer_ids,
+                               hash_table_t* scratch,
+                               id_set_t* merged,
+                               int window_size, int step_size,
+                               const substitution_table_t* substitutions
+                             );
 
 
 
@@ -55,24 +71,38 @@ int count_letters( char* in_str )
 
 int get_blosum_dist( blosum_data_t* in_data, char first, char second )
 {
-    int index = 0;
-    int return_dist = DATA_NOT_FOUND;
-    int len = strlen( in_data->letter_data );
-    int* first_distances = ht_find( in_data->blosum_table, &first );
+    return in_data->distances[ residue_to_code( first ) ][ residue_to_code( second ) ];
+}
 
-    if( first_distances != NULL )
+static uint32_t allowed_substitutions( const blosum_data_t* blosum_data, int row,
+                                       int blosum_cutoff
+                                     )
+{
+    int column;
+    int distance;
+    uint32_t allowed = 0;
+
+    for( column = 0; column < NUM_RESIDUE_CODES; column++ )
         {
-            while( in_data->letter_data[ index ] != second &&
-                   index < len
-                 )
+            distance = blosum_data->distances[ row ][ column ];
+            if( distance != DATA_NOT_FOUND && distance >= blosum_cutoff )
                 {
-                    index++;
+                    allowed |= UINT32_C( 1 ) << column;
                 }
-
-            return_dist = first_distances[ index ];
         }
+    return allowed;
+}
+
+void blosum_set_cutoff( blosum_data_t* blosum_data, int blosum_cutoff )
+{
+    int row;
 
-    return return_dist;
+    blosum_data->cutoff = blosum_cutoff;
+
+    for( row = 0; row < NUM_RESIDUE_CODES; row++ )
+        {
+            blosum_data->allowed[ row ] = allowed_substitutions( blosum_data, row, blosum_cutoff );
+        }
 }
 
 void get_alpha_chars( char* dest, char* source, int num_chars )
@@ -109,27 +139,32 @@ void get_ints_from_string( int* dest, char* src, int num_rows )
         }
 }
 
-void get_blosum_distances( hash_table_t* blosum_distance, FILE* blosum_file, int num_rows )
+void get_blosum_distances( blosum_data_t* blosum_data, FILE* blosum_file, int num_rows )
 {
     char* found_line = NULL;
     char current_line[ LINE_SIZE ] ;
-    int* current_distance_data = NULL;
-    char key[ 2 ];
+    int* current_distance_data = calloc( num_rows > 0 ? num_rows : 1, sizeof( int ) );
+    int index;
+    uint8_t row_code;
 
     found_line = fgets( current_line, LINE_SIZE, blosum_file );
 
     while( found_line )
         {
-            current_distance_data = malloc( sizeof( int ) * num_rows );
-
-            strncpy( key, current_line, 1 );
-            key[ 1 ] = '\0';
+            row_code = residue_to_code( current_line[ 0 ] );
 
+            memset( current_distance_data, 0, num_rows * sizeof( int ) );
             get_ints_from_string( current_distance_data, current_line, num_rows );
-            ht_add( blosum_distance, key, current_distance_data );
+
+            for( index = 0; index < num_rows && row_code != INVALID_RESIDUE_CODE; index++ )
+                {
+                    blosum_data->distances[ row_code ][ residue_to_code( blosum_data->letter_data[ index ] ) ] =
+                        current_distance_data[ index ];
+                }
 
             found_line = fgets( current_line, LINE_SIZE, blosum_file );
         }
+    free( current_distance_data );
 }
 
 void read_sequences( FILE* file_to_read, sequence_t** in_sequence )
@@ -347,52 +382,30 @@ void append_suffix( char* result, char* in_name, int start, int end )
 hash_table_t* subset_lists( hash_table_t* in_hash,
                             char* in_seq,
                             int window_size, int step_size,
-                            blosum_data_t* blosum_data,
-                            int blosum_cutoff,
-                            int permute
+                            const substitution_table_t* substitutions
                           )
 {
     int outer_index;
     int num_subsets = calc_num_subseqs( strlen( in_seq ), window_size );
 
-    uint32_t permute_index;
-
-    char *current_xmer;
-
-    array_list_t *current_xmer_permutations;
+    char current_xmer[ window_size + 1 ];
 
     for( outer_index = 0; outer_index < num_subsets; outer_index++ )
         {
-
-            current_xmer = malloc( window_size + 1 );
-
-
             write_xmer( current_xmer, in_seq, outer_index, window_size, step_size );
 
-            if( permute || blosum_data )
+            if( substitutions )
                 {
-                    current_xmer_permutations = malloc( sizeof( array_list_t ) );
-                    ar_init( current_xmer_permutations );
-                    permute_xmer_functional_groups( current_xmer, current_xmer_permutations,
-                                                    blosum_data, blosum_cutoff
-                                                  );
-
-                    for(  permute_index = 0; permute_index < current_xmer_permutations->size; permute_index++ )
-                        {
-                            current_xmer = ar_get( current_xmer_permutations, permute_index );
-                            ht_add( in_hash, current_xmer, NULL );
-
-                            free( current_xmer );
-                        }
-
-                    ar_clear( current_xmer_permutations );
-
+                    visit_xmer_permutations( current_xmer, window_size, substitutions,
+                                             add_permutation_to_table, in_hash
+                                           );
                 }
 
             // update the entry at this location
             ht_add( in_hash, current_xmer, NULL );
 
         }
+
     return in_hash;
 }
 
@@ -464,84 +477,204 @@ hash_table_t* create_xmers_with_locs( hash_table_t* in_hash, char* in_name,
 
 
 
-set_t* component_xmer_locs( char* in_ymer_name, char* in_ymer,
-                            set_t* out_ymer,
-                            hash_table_t* in_xmer_table,
-                            int window_size, int step_size,
-                            blosum_data_t* blosum_data,
-                            int blosum_cutoff, 
-                            int permute
-                          )
+static int num_xmers_in( int length, int window_size, int step_size )
 {
-    int num_xmers = ( window_size - step_size ) + 1;
-    uint32_t inner_index;
-    uint32_t index;
-    hash_table_t* subset_xmers = NULL;
-    HT_Entry** subset_xmer_items = NULL;
-    array_list_t* found_data = NULL;
-
-    uint32_t size;
-
-    subset_xmers = malloc( sizeof( hash_table_t ) );
+    if( length < window_size || step_size <= 0 )
+        {
+            return 0;
+        }
+    return ( ( length - window_size ) / step_size ) + 1;
+}
 
-    ht_init( subset_xmers, num_xmers );
+static int max_permuted_xmers( int num_xmers, int window_size,
+                               const substitution_table_t* substitutions
+                             )
+{
+    int code;
+    int max_substitutions = 0;
 
-    create_xmers_with_locs( subset_xmers, in_ymer_name, in_ymer,
-                            window_size, step_size );
+    for( code = 0; substitutions && code < NUM_RESIDUE_CODES; code++ )
+        {
+            if( substitutions->num_substitutions[ code ] > max_substitutions )
+                {
+                    max_substitutions = substitutions->num_substitutions[ code ];
+                }
+        }
+    return num_xmers * ( 1 + ( window_size * max_substitutions ) );
+}
 
-    subset_xmer_items = ht_get_items( subset_xmers );
+static void resolve_ymer_locs( char* in_ymer, id_set_t* out_ymer,
+                               hash_table_t* in_xmer_ids,
+                               hash_table_t* scratch,
+                               id_set_t* merged,
+                               int window_size, int step_size,
+                               const substitution_table_t* substitutions
+                             )
+{
+    int index;
+    int num_xmers = num_xmers_in( strlen( in_ymer ), window_size, step_size );
+    uint32_t item_index;
+    char current_xmer[ window_size + 1 ];
 
-    size = subset_xmers->size;
+    HT_Entry** scratch_items = NULL;
+    id_set_t* found_ids = NULL;
+    id_set_t swap;
 
-    if( permute || blosum_data )
+    for( index = 0; index < num_xmers; index++ )
         {
-            for( index = 0; index < size; index++ )
-                {
+            write_xmer( current_xmer, in_ymer, index, window_size, step_size );
 
-                    found_data = malloc( sizeof( array_list_t ) );
-                    ar_init( found_data );
+            if( !char_in_string( current_xmer, 'X' ) )
+                {
+                    ht_add( scratch, current_xmer, NULL );
 
-                    permute_xmer_functional_groups( subset_xmer_items[ index ]->key, found_data,
-                                                    blosum_data, blosum_cutoff
-                                                  );
-                    for( inner_index = 0; inner_index < found_data->size; inner_index++ )
+                    if( substitutions )
                         {
-                            ht_add( subset_xmers, ar_get( found_data, inner_index ), NULL );
+                            visit_xmer_permutations( current_xmer, window_size, substitutions,
+                                                     add_permutation_to_table, scratch
+                                                   );
                         }
+                }
+        }
 
+    scratch_items = ht_get_items( scratch );
 
-                    for( inner_index = 0; inner_index < found_data->size; inner_index++ )
-                        {
-                            free( ar_get( found_data, inner_index ) );
-                        }
-                    ar_clear( found_data );
+    for( item_index = 0; item_index < scratch->size; item_index++ )
+        {
+            found_ids = (id_set_t*) ht_find( in_xmer_ids, scratch_items[ item_index ]->key );
+            if( found_ids != NULL )
+                {
+                    // merge into merged, then swap it in, so each xmer is one linear pass
+                    id_set_union( merged, out_ymer, found_ids );
+                    swap = *out_ymer;
+                    *out_ymer = *merged;
+                    *merged = swap;
                 }
-
         }
 
-   free( subset_xmer_items );
-   subset_xmer_items = ht_get_items( subset_xmers );
+    free( scratch_items );
+    ht_reset( scratch );
+}
 
-    for( index = 0; index < subset_xmers->size; index++ )
+void intern_xmer_locs( hash_table_t* out_xmer_ids, hash_table_t* in_xmer_table,
+                       string_interner_t* interner
+                     )
+{
+    HT_Entry** xmer_items = ht_get_items( in_xmer_table );
+    array_list_t* locations = NULL;
+    id_set_t* location_ids = NULL;
+    uint32_t* ids = NULL;
+    uint32_t item_index;
+    uint32_t loc_index;
+
+    for( item_index = 0; item_index < in_xmer_table->size; item_index++ )
         {
-            found_data = (array_list_t*) ht_find( in_xmer_table, subset_xmer_items[ index ]->key );
-            if( found_data != NULL )
-                {
-                    set_add_all( out_ymer, (char**) found_data->array_data, found_data->size );
+            locations = (array_list_t*) xmer_items[ item_index ]->value;
+            ids = realloc( ids, ( locations->size + 1 ) * sizeof( uint32_t ) );
 
-                    if( subset_xmer_items[ index ]->value )
-                        {
-                            ar_clear( subset_xmer_items[ index ]->value );
-                        }
+            for( loc_index = 0; loc_index < locations->size; loc_index++ )
+                {
+                    ids[ loc_index ] = intern( interner, ar_get( locations, loc_index ) );
                 }
+
+            location_ids = malloc( sizeof( id_set_t ) );
+            id_set_init( location_ids, locations->size );
+            id_set_add_all( location_ids, ids, locations->size );
+
+            ht_add( out_xmer_ids, xmer_items[ item_index ]->key, location_ids );
+        }
+
+    free( ids );
+    free( xmer_items );
+}
+
+void xmer_ids_clear( hash_table_t* xmer_ids )
+{
+    HT_Entry** xmer_items = ht_get_items( xmer_ids );
+    uint32_t item_index;
+
+    for( item_index = 0; item_index < xmer_ids->size; item_index++ )
+        {
+            id_set_clear( xmer_items[ item_index ]->value );
+            free( xmer_items[ item_index ]->value );
         }
 
-    free( subset_xmer_items );
-    ht_clear( subset_xmers );
-    free( subset_xmers );
+    free( xmer_items );
+    ht_clear( xmer_ids );
+}
+
+id_set_t* component_xmer_locs( char* in_ymer,
+                               id_set_t* out_ymer,
+                               hash_table_t* in_xmer_ids,
+                               int window_size, int step_size,
+                               const substitution_table_t* substitutions
+                             )
+{
+    int num_xmers = num_xmers_in( strlen( in_ymer ), window_size, step_size );
+    hash_table_t subset_xmers;
+    id_set_t merged;
+
+    ht_init( &subset_xmers,
+             max_permuted_xmers( num_xmers, window_size, substitutions ) + 1
+           );
+    id_set_init( &merged, out_ymer->capacity );
+
+    resolve_ymer_locs( in_ymer, out_ymer, in_xmer_ids, &subset_xmers, &merged,
+                       window_size, step_size, substitutions
+                     );
+
+    id_set_clear( &merged );
+    ht_clear( &subset_xmers );
     return out_ymer;
 }
 
+void component_xmer_locs_batch( char** in_ymers, int num_ymers,
+                                id_set_t** out_ymers,
+                                hash_table_t* in_xmer_ids,
+                                int window_size, int step_size,
+                                const substitution_table_t* substitutions
+                              )
+{
+    int index;
+    int length;
+    int max_length = 0;
+    int scratch_size;
+
+    for( index = 0; index < num_ymers; index++ )
+        {
+            length = strlen( in_ymers[ index ] );
+            if( length > max_length )
+                {
+                    max_length = length;
+                }
+        }
+
+    scratch_size = max_permuted_xmers( num_xmers_in( max_length, window_size, step_size ),
+                                       window_size, substitutions
+                                     ) + 1;
+
+    #pragma omp parallel private( index )
+    {
+        hash_table_t scratch;
+        id_set_t merged;
+
+        ht_init( &scratch, scratch_size );
+        id_set_init( &merged, 0 );
+
+        #pragma omp for schedule( dynamic, 64 )
+        for( index = 0; index < num_ymers; index++ )
+            {
+                resolve_ymer_locs( in_ymers[ index ], out_ymers[ index ],
+                                   in_xmer_ids, &scratch, &merged,
+                                   window_size, step_size, substitutions
+                                 );
+            }
+
+        id_set_clear( &merged );
+        ht_clear( &scratch );
+    }
+}
+
 
 void *malloc_track( array_list_t* data, int num_bytes )
 {
@@ -560,61 +693,119 @@ void free_data( array_list_t* in_data )
         }
 }
 
+static void append_permutation( char* permutation, void* permutations )
+{
+    char* copied_string = malloc( strlen( permutation ) + 1 );
+
+    strcpy( copied_string, permutation );
+    ar_add( (array_list_t*) permutations, copied_string );
+}
+
+static void add_permutation_to_table( char* permutation, void* table )
+{
+    ht_add( (hash_table_t*) table, permutation, NULL );
+}
+
+// rows hold at most NUM_RESIDUE_CODES substitutions, a matrix with more
+// letters than that has duplicate codes and the extra ones are dropped
+static void add_substitution( substitution_table_t* table, int code, char residue )
+{
+    if( table->num_substitutions[ code ] < NUM_RESIDUE_CODES )
+        {
+            table->substitutions[ code ][ table->num_substitutions[ code ]++ ] = residue;
+        }
+}
+
 void permute_xmer_functional_groups( char* str_to_change,
                                      array_list_t* permutations,
                                      blosum_data_t* blosum_data,
                                      int blosum_cutoff
                                    )
 {
-    int length = strlen( str_to_change );
-    int index;
-    size_t inner_index;
-    int blosum_dist;
+    substitution_table_t substitutions;
 
-    char *copied_string = NULL;
-    char original_char = '\0';
-    char copy_string[ length + 1 ];
+    substitution_table_init( &substitutions, blosum_data, blosum_cutoff );
+    visit_xmer_permutations( str_to_change, strlen( str_to_change ),
+                             &substitutions, append_permutation, permutations
+                           );
+}
 
-    char different_char = '\0';
+void substitution_table_init( substitution_table_t* table,
+                              blosum_data_t* blosum_data,
+                              int blosum_cutoff
+                            )
+{
+    int code;
+    int inner_code;
+    uint32_t allowed;
+    char original_char;
+    char different_char;
 
-    copied_string = malloc( sizeof( char ) * length + 1 );
-    for( index = 0; index < length; index++ )
-        {
-            memset( copy_string, '\0', sizeof( copy_string ) );
-            strcpy( copy_string, str_to_change );
-            original_char = copy_string[ index ];
+    memset( table->num_substitutions, 0, sizeof( table->num_substitutions ) );
 
-            different_char = get_first_char_in_functional_group( copy_string[ index ] );
+    for( code = 0; code < NUM_RESIDUE_CODES; code++ )
+        {
+            original_char = code_to_residue( code );
+            if( !original_char )
+                {
+                    continue;
+                }
 
             if( blosum_data )
                 {
-                    for( inner_index = 0; inner_index < strlen( blosum_data->letter_data ); inner_index++ )
+                    allowed = blosum_cutoff == blosum_data->cutoff ?
+                              blosum_data->allowed[ code ] :
+                              allowed_substitutions( blosum_data, code, blosum_cutoff );
+
+                    // one bit per residue code, so a row never overflows
+                    for( inner_code = 0; allowed; inner_code++, allowed >>= 1 )
                         {
-                            different_char = blosum_data->letter_data[ inner_index ];
-                            blosum_dist = get_blosum_dist( blosum_data, original_char, different_char );
-                            if( blosum_dist >= blosum_cutoff )
+                            if( ( allowed & 1 ) && code_to_residue( inner_code ) )
                                 {
-                                    copy_string[ index ] = different_char;
-                                    copied_string = malloc( sizeof( char ) * length + 1 );
-                                    strcpy( copied_string, copy_string );
-                                    ar_add( permutations, copied_string );
+                                    add_substitution( table, code, code_to_residue( inner_code ) );
                                 }
                         }
                 }
             else
                 {
+                    different_char = get_first_char_in_functional_group( original_char );
                     while( different_char )
                         {
-                            copy_string[ index ] = different_char;
-                            copied_string = malloc( sizeof( char ) * length + 1 );
-                            strcpy( copied_string, copy_string );
-                            ar_add( permutations, copied_string );
-
+                            add_substitution( table, code, different_char );
                             different_char = get_corresponding_char( different_char );
                         }
+                }
+        }
+}
+
+int visit_xmer_permutations( const char* xmer, int length,
+                             const substitution_table_t* table,
+                             permutation_visitor_t visit,
+                             void* visitor_data
+                           )
+{
+    int index;
+    int inner_index;
+    int num_visited = 0;
+    uint8_t code;
+    char permutation[ length + 1 ];
+
+    memcpy( permutation, xmer, length );
+    permutation[ length ] = '\0';
+
+    for( index = 0; index < length; index++ )
+        {
+            code = residue_to_code( xmer[ index ] );
 
+            for( inner_index = 0; inner_index < table->num_substitutions[ code ]; inner_index++ )
+                {
+                    permutation[ index ] = table->substitutions[ code ][ inner_index ];
+                    visit( permutation, visitor_data );
                 }
+            num_visited += table->num_substitutions[ code ];
+            permutation[ index ] = xmer[ index ];
         }
+    return num_visited;
 }
 
 void xmer_first_functional_group( char* in_string, int str_len  )
@@ -627,6 +818,19 @@ void xmer_first_functional_group( char* in_string, int str_len  )
         }
 }
 
+void xmer_to_functional_groups( char* dest, const char* src, int length )
+{
+    int index;
+    char group_char;
+
+    for( index = 0; index < length; index++ )
+        {
+            group_char = get_first_char_in_functional_group( src[ index ] );
+            dest[ index ] = group_char ? group_char : src[ index ];
+        }
+    dest[ length ] = '\0';
+}
+
 char get_corresponding_char( char in_char )
 {
     switch( in_char )
@@ -704,7 +908,6 @@ blosum_data_t* parse_blosum_file( FILE* file_name )
     char* letter_data = NULL;
     char* current_line = malloc( LINE_SIZE );
 
-    hash_table_t* blosum_distances = NULL;
     blosum_data_t* blosum_data = NULL;
 
     if( blosum )
@@ -723,15 +926,16 @@ blosum_data_t* parse_blosum_file( FILE* file_name )
                     letter_data = malloc( sizeof( char ) * row_count + 1 );
                     blosum_data = malloc( sizeof( blosum_data_t ) );
 
-                    blosum_distances = malloc( sizeof( hash_table_t ) );
-                    ht_init( blosum_distances, row_count );
-
                     get_alpha_chars( letter_data, current_line, row_count );
-                    get_blosum_distances( blosum_distances, blosum, row_count );
 
                     blosum_data->letter_data = letter_data;
-                    blosum_data->blosum_table = blosum_distances;
-                    
+                    memset( blosum_data->distances, DATA_NOT_FOUND,
+                            sizeof( blosum_data->distances )
+                          );
+
+                    get_blosum_distances( blosum_data, blosum, row_count );
+                    blosum_set_cutoff( blosum_data, DEFAULT_BLOSUM_CUTOFF );
+
                 }
 
                 
@@ -5,6 +5,8 @@
 #include "array_list.h"
 #include "hash_table.h"
 #include "set.h"
+#include "id_set.h"
+#include "kmer_code.h"
 
 typedef struct sequence_t
 {
@@ -18,13 +20,41 @@ typedef struct subset_data_t
     unsigned int end;
 } subset_data_t;
 
+#define BLOSUM_DATA_NOT_FOUND -99
+#define DEFAULT_BLOSUM_CUTOFF 0
+
+/**
+ * distances is indexed directly by the residue codes of two amino acids,
+ * entries not given by the blosum file hold BLOSUM_DATA_NOT_FOUND.
+ * Bit c of allowed[ r ] is set when distances[ r ][ c ] >= cutoff.
+ **/
 typedef struct blosum_data_t
 {
     char* letter_data;
-    hash_table_t* blosum_table;
-    
+
+    int8_t distances[ NUM_RESIDUE_CODES ][ NUM_RESIDUE_CODES ];
+    uint32_t allowed[ NUM_RESIDUE_CODES ];
+    int cutoff;
 } blosum_data_t;
 
+/**
+ * For every residue code, the residues a kmer position holding that
+ * residue may be changed to when permuting, in the order they are tried
+ **/
+typedef struct substitution_table_t
+{
+    uint8_t num_substitutions[ NUM_RESIDUE_CODES ];
+    char substitutions[ NUM_RESIDUE_CODES ][ NUM_RESIDUE_CODES ];
+} substitution_table_t;
+
+/**
+ * Called once for each permutation of an xmer
+ * @param permutation NUL-terminated permutation. Only valid for
+ *        the duration of the call, copy it to keep it.
+ * @param visitor_data pointer passed through from the enumerator
+ **/
+typedef void (*permutation_visitor_t)( char* permutation, void* visitor_data );
+
 
 
 /**
@@ -116,52 +146,81 @@ hash_table_t* create_xmers_with_locs( hash_table_t* in_hash, char* name,
                                       char* in_seq,
                                       int window_size, int step_size );
 
+/**
+ * Interns the locations of every xmer in a table made by create_xmers_with_locs,
+ * so that ymers can be resolved to sets of integer location ids
+ * @param out_xmer_ids pointer to initialized hash table, each xmer of
+ *        in_xmer_table is added with an id_set_t of its location ids as value
+ * @param in_xmer_table pointer to xmer table whose values are array lists
+ *        of location strings
+ * @param interner pointer to initialized string_interner_t, maps the ids
+ *        back to location strings
+ **/
+void intern_xmer_locs( hash_table_t* out_xmer_ids, hash_table_t* in_xmer_table,
+                       string_interner_t* interner
+                     );
+
+/**
+ * Frees a table made by intern_xmer_locs, including its id sets
+ * @param xmer_ids pointer to hash table to clear
+ **/
+void xmer_ids_clear( hash_table_t* xmer_ids );
+
 /**
  * Break a ymer down into into the unique locations of its xmers
- * @param in_ymer_name string name of the ymer input to method
  * @param in_ymer string ymer
- * @param in_xmer_table pointer to xmer table containing xmers to search
+ * @param out_ymer pointer to initialized id set to add the location ids to
+ * @param in_xmer_ids pointer to table made by intern_xmer_locs
  * @param window_size integer size of each xmer
  * @param step_size integer amount to move over after each ymer capture
- * @param permute boolean option to permute xmer functional groups
- * @param blosum_data pointer to blosum_data_t containing the data found from a blosum
-          matrix file
- *         Note: if the -b flag is not used, this will be NULL
- * @param blosum_cutoff integer cutoff score that means a change
- *        will be made
-
- * @returns set of strings containing the locations of in_ymer's xmers
+ * @param substitutions pointer to substitution_table_t built once by
+ *        substitution_table_init, or NULL to look up xmers unchanged
+ * @returns set of the ids of the locations of in_ymer's xmers, use
+ *          interner_string to get the location strings
  **/
-set_t* component_xmer_locs( char* in_ymer_name, char* in_ymer,
-                            set_t* out_ymer,
-                            hash_table_t* in_xmer_table,
-                            int window_size, int step_size,
-                            blosum_data_t* blosum_data,
-                            int blosum_cutoff,
-                            int permute
-                          );
+id_set_t* component_xmer_locs( char* in_ymer,
+                               id_set_t* out_ymer,
+                               hash_table_t* in_xmer_ids,
+                               int window_size, int step_size,
+                               const substitution_table_t* substitutions
+                             );
+/**
+ * Breaks many ymers down into the unique locations of their xmers,
+ * resolving ymers in parallel when built with OpenMP
+ * Note: in_xmer_ids is only read, each thread reuses one scratch
+ *       table for all of the ymers it resolves
+ * @param in_ymers array of num_ymers string ymers
+ * @param num_ymers number of ymers to resolve
+ * @param out_ymers array of num_ymers pointers to initialized id sets,
+ *        out_ymers[ i ] receives the location ids of in_ymers[ i ]
+ * @param in_xmer_ids pointer to table made by intern_xmer_locs
+ * @param window_size integer size of each xmer
+ * @param step_size integer amount to move over after each xmer capture
+ * @param substitutions pointer to substitution_table_t used to permute
+ *        each xmer, or NULL to look up xmers unchanged
+ **/
+void component_xmer_locs_batch( char** in_ymers, int num_ymers,
+                                id_set_t** out_ymers,
+                                hash_table_t* in_xmer_ids,
+                                int window_size, int step_size,
+                                const substitution_table_t* substitutions
+                              );
+
 /**
  * Break a ymer down into its xmers, the value of each xmer is NULL
  * @param in_hash pointer to hash_table to add the valid xmers to
  * @param in_seq pointer to string to create a subset of 
  * @param window_size integer number of characters to capture with each iteration
  * @param step_size integer number of characters to move over after each iteration
- * @param permute boolean option whether or not xmer permutation should be done
- * @param blosum_data pointer to blosum_data_t containing the data found from a blosum
- *         matrix file
- *         Note: if the -b flag is not used, this will be NULL
- * @param blosum_cutoff integer cutoff score that means a change
- *        will be made
-
+ * @param substitutions pointer to substitution_table_t built once by
+ *        substitution_table_init, or NULL to add only the xmers themselves
  * @returns pointer to hash table containing all of the subsets of the sequence, 
  *          as key, and an array list of subset_data_t as key containing start/end
  **/
 hash_table_t* subset_lists( hash_table_t* in_hash,
                             char* in_seq,
                             int window_size, int step_size,
-                            blosum_data_t* blosum_data,
-                            int blosum_cutoff,
-                            int permute
+                            const substitution_table_t* substitutions
                           );
 
 
@@ -208,9 +267,55 @@ void permute_xmer_functional_groups( char* str_to_change,
                                      int blosum_cutoff
                                    );
 
+/**
+ * Maps an xmer into the reduced alphabet defined by the functional
+ * groupings of amino acids, replacing every residue with the first
+ * residue of its group. Residues outside of any group are kept.
+ * Note: dest and src may be the same string
+ * @param dest character array of at least length + 1 bytes to write
+ *        the NUL-terminated reduced xmer to
+ * @param src xmer to reduce
+ * @param length number of characters of src to reduce
+ **/
+void xmer_to_functional_groups( char* dest, const char* src, int length );
+
+/**
+ * Precomputes the substitutions permute_xmer_functional_groups makes
+ * for each residue
+ * Note: Each residue gets at most NUM_RESIDUE_CODES substitutions
+ * @param table pointer to substitution_table_t to fill
+ * @param blosum_data pointer to blosum_data_t containing the data found from a blosum
+ *         matrix file, or NULL to substitute within functional groups
+ * @param blosum_cutoff integer cutoff score that means a change
+ *        will be made
+ **/
+void substitution_table_init( substitution_table_t* table,
+                              blosum_data_t* blosum_data,
+                              int blosum_cutoff
+                            );
+
+/**
+ * Enumerates each 1-permutation of an xmer without allocating, calling
+ * visit once per permutation. Permutations are produced in the same order
+ * as permute_xmer_functional_groups.
+ * @param xmer string xmer to permute
+ * @param length number of characters in xmer
+ * @param table pointer to substitution_table_t built by substitution_table_init
+ * @param visit function called with each permutation
+ * @param visitor_data pointer passed to each call of visit
+ * @returns integer number of permutations visited
+ **/
+int visit_xmer_permutations( const char* xmer, int length,
+                             const substitution_table_t* table,
+                             permutation_visitor_t visit,
+                             void* visitor_data
+                           );
+
 /**
  * Parses a blosum file containing a blosum substitution
  * matrix
+ * Note: The allowed substitution masks are computed for
+ *       DEFAULT_BLOSUM_CUTOFF, use blosum_set_cutoff to change it
  * @param file_name string name of file to open and parse
  * @returns blosum_data_t* pointer to struct containing
  *          an array of character amino acids found in the file,
@@ -218,4 +323,23 @@ void permute_xmer_functional_groups( char* str_to_change,
  **/
 blosum_data_t* parse_blosum_file( FILE* file_name );
 
+/**
+ * Gets the blosum distance between two amino acids
+ * @param in_data pointer to blosum_data_t to look the distance up in
+ * @param first amino acid giving the row of the matrix
+ * @param second amino acid giving the column of the matrix
+ * @returns integer distance, or BLOSUM_DATA_NOT_FOUND if the matrix
+ *          does not contain either amino acid
+ **/
+int get_blosum_dist( blosum_data_t* in_data, char first, char second );
+
+/**
+ * Recomputes the allowed substitution masks of blosum data so that
+ * a substitution is allowed when its distance is at least blosum_cutoff
+ * @param blosum_data pointer to blosum_data_t to update
+ * @param blosum_cutoff integer cutoff score that means a change
+ *        will be made
+ **/
+void blosum_set_cutoff( blosum_data_t* blosum_data, int blosum_cutoff );
+
 #endif
@@ -0,0 +1,227 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "run_stats.h"
+
+static const char *STAGE_NAMES[ NUM_STATS_STAGES ] =
+{
+    "read_reference",
+    "read_designs",
+    "build_table",
+    "count",
+    "match",
+    "merge",
+    "sort",
+    "write"
+};
+
+void stats_init( run_stats_t *stats )
+{
+    memset( stats, 0, sizeof( run_stats_t ) );
+}
+
+double stats_time( void )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void stats_add_time( run_stats_t *stats, stats_stage_t stage, double start )
+{
+    stats->stage_seconds[ stage ] += stats_time() - start;
+}
+
+void stats_add_perf( run_stats_t *stats, stats_stage_t stage,
+                     const uint64_t *start, const uint64_t *end
+                   )
+{
+    int event = 0;
+
+    for( event = 0; event < NUM_PERF_EVENTS; event++ )
+        {
+            stats->perf_counts[ stage ][ event ] += end[ event ] - start[ event ];
+        }
+}
+
+static void write_perf_json( const run_stats_t *stats, FILE *out_file )
+{
+    const uint64_t *counts = NULL;
+    int stage = 0;
+    int event = 0;
+
+    fprintf( out_file, ",\n  \"perf\": {\n" );
+    for( stage = 0; stage < NUM_STATS_STAGES; stage++ )
+        {
+            counts = stats->perf_counts[ stage ];
+            fprintf( out_file, "    \"%s\": {", stats_stage_name( stage ) );
+            for( event = 0; event < NUM_PERF_EVENTS; event++ )
+                {
+                    if( stats->perf_events & ( 1u << event ) )
+                        {
+                            fprintf( out_file, " \"%s\": %" PRIu64 ",",
+                                     perf_event_name( event ), counts[ event ]
+                                   );
+                        }
+                }
+
+            // instructions per cycle, only when both were counted
+            if( ( stats->perf_events & ( 1u << PERF_CYCLES ) )
+                && ( stats->perf_events & ( 1u << PERF_INSTRUCTIONS ) )
+                && counts[ PERF_CYCLES ]
+              )
+                {
+                    fprintf( out_file, " \"ipc\": %.3f,",
+                             (double) counts[ PERF_INSTRUCTIONS ] / counts[ PERF_CYCLES ]
+                           );
+                }
+            fprintf( out_file, " \"seconds\": %.6f }%s\n", stats->stage_seconds[ stage ],
+                     stage + 1 < NUM_STATS_STAGES ? "," : ""
+                   );
+        }
+    fprintf( out_file, "  }" );
+}
+
+void stats_add_table( run_stats_t *stats, const char *name, int window_size,
+                      const ht_stats_t *occupancy
+                    )
+{
+    char table_name[ sizeof( stats->tables[ 0 ].name ) ];
+    int index = 0;
+
+    snprintf( table_name, sizeof( table_name ), "%s_k%d", name, window_size );
+    for( index = 0; index < stats->num_tables; index++ )
+        {
+            if( !strcmp( stats->tables[ index ].name, table_name ) )
+                {
+                    ht_stats_add( &stats->tables[ index ].occupancy, occupancy );
+                    return;
+                }
+        }
+
+    if( stats->num_tables < MAX_STATS_TABLES )
+        {
+            strcpy( stats->tables[ stats->num_tables ].name, table_name );
+            stats->tables[ stats->num_tables ].occupancy = *occupancy;
+            stats->num_tables++;
+        }
+}
+
+static void write_tables_json( const run_stats_t *stats, FILE *out_file )
+{
+    const ht_stats_t *occupancy = NULL;
+    int index = 0;
+    int length = 0;
+
+    fprintf( out_file, ",\n  \"tables\": {\n" );
+    for( index = 0; index < stats->num_tables; index++ )
+        {
+            occupancy = &stats->tables[ index ].occupancy;
+            fprintf( out_file, "    \"%s\": {\n", stats->tables[ index ].name );
+            fprintf( out_file, "      \"tables\": %" PRIu64 ",\n", occupancy->tables );
+            fprintf( out_file, "      \"entries\": %" PRIu64 ",\n", occupancy->entries );
+            fprintf( out_file, "      \"buckets\": %" PRIu64 ",\n", occupancy->buckets );
+            fprintf( out_file, "      \"load_factor\": %.4f,\n",
+                     occupancy->buckets ? (double) occupancy->entries / occupancy->buckets : 0
+                   );
+            fprintf( out_file, "      \"empty_bucket_fraction\": %.4f,\n",
+                     occupancy->buckets ? (double) occupancy->empty_buckets / occupancy->buckets : 0
+                   );
+            fprintf( out_file, "      \"mean_probe_length\": %.4f,\n",
+                     occupancy->entries ? (double) occupancy->probes / occupancy->entries : 0
+                   );
+            fprintf( out_file, "      \"longest_chain\": %" PRIu64 ",\n", occupancy->longest_chain );
+
+            // the last count is of chains at least that long
+            fprintf( out_file, "      \"chain_lengths\": [" );
+            for( length = 0; length < HT_CHAIN_HISTOGRAM_SIZE; length++ )
+                {
+                    fprintf( out_file, "%s%" PRIu64, length ? ", " : " ",
+                             occupancy->chain_lengths[ length ]
+                           );
+                }
+            fprintf( out_file, " ],\n" );
+
+            // 1 for a uniform random hash, larger when keys cluster
+            fprintf( out_file, "      \"collision_ratio\": %.4f,\n",
+                     occupancy->expected_pairs > 0
+                     ? occupancy->colliding_pairs / occupancy->expected_pairs : 0
+                   );
+            fprintf( out_file, "      \"bytes\": %" PRIu64 "\n", occupancy->bytes );
+            fprintf( out_file, "    }%s\n", index + 1 < stats->num_tables ? "," : "" );
+        }
+    fprintf( out_file, "  }" );
+}
+
+const char *stats_stage_name( stats_stage_t stage )
+{
+    return STAGE_NAMES[ stage ];
+}
+
+uint64_t stats_file_size( const char *file_name )
+{
+    struct stat file_info;
+
+    if( stat( file_name, &file_info ) != 0 )
+        {
+            return 0;
+        }
+    return file_info.st_size;
+}
+
+int stats_write_json( const run_stats_t *stats, double total_seconds,
+                      int num_threads, const char *file_name
+                    )
+{
+    FILE *out_file = stdout;
+    int stage = 0;
+    int success = 0;
+
+    if( strcmp( file_name, "-" ) )
+        {
+            out_file = fopen( file_name, "w" );
+            if( !out_file )
+                {
+                    return 0;
+                }
+        }
+
+    fprintf( out_file, "{\n  \"threads\": %d,\n  \"total_seconds\": %.6f,\n  \"stages\": {\n",
+             num_threads, total_seconds
+           );
+    for( stage = 0; stage < NUM_STATS_STAGES; stage++ )
+        {
+            fprintf( out_file, "    \"%s\": %.6f%s\n", stats_stage_name( stage ),
+                     stats->stage_seconds[ stage ], stage + 1 < NUM_STATS_STAGES ? "," : ""
+                   );
+        }
+    fprintf( out_file, "  },\n  \"counters\": {\n" );
+    fprintf( out_file, "    \"kmers_extracted\": %" PRIu64 ",\n", stats->kmers_extracted );
+    fprintf( out_file, "    \"unique_kmers\": %" PRIu64 ",\n", stats->unique_kmers );
+    fprintf( out_file, "    \"comparisons\": %" PRIu64 ",\n", stats->comparisons );
+    fprintf( out_file, "    \"matches\": %" PRIu64 ",\n", stats->matches );
+    fprintf( out_file, "    \"bytes_read\": %" PRIu64 ",\n", stats->bytes_read );
+    fprintf( out_file, "    \"bytes_written\": %" PRIu64 "\n", stats->bytes_written );
+    fprintf( out_file, "  }" );
+    if( stats->perf_events )
+        {
+            write_perf_json( stats, out_file );
+        }
+    if( stats->num_tables )
+        {
+            write_tables_json( stats, out_file );
+        }
+    fprintf( out_file, "\n}\n" );
+
+    success = !ferror( out_file );
+    if( out_file != stdout )
+        {
+            success = fclose( out_file ) == 0 && success;
+        }
+    return success;
+}
@@ -0,0 +1,152 @@
+#ifndef RUN_STATS_H_INCLUDED
+#define RUN_STATS_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "perf_counters.h"
+#include "hash_table.h"
+
+// most tables whose occupancy one run records
+#define MAX_STATS_TABLES 32
+
+/**
+ * Stages of a counting run that are timed separately
+ * Note: STAGE_MATCH is time threads spend comparing design kmers with
+ *       the targets, STAGE_MERGE time spent adding each thread's scores
+ *       into the shared table. Both are summed over threads and are part
+ *       of STAGE_COUNT. The reduced alphabet counts only as STAGE_COUNT
+ **/
+typedef enum stats_stage
+{
+    STAGE_READ_REFERENCE,
+    STAGE_READ_DESIGNS,
+    STAGE_BUILD_TABLE,
+    STAGE_COUNT,
+    STAGE_MATCH,
+    STAGE_MERGE,
+    STAGE_SORT,
+    STAGE_WRITE,
+    NUM_STATS_STAGES
+} stats_stage_t;
+
+/**
+ * Occupancy of a kind of table, such as the target kmers of one
+ * window size or every per-oligo table of one window size
+ **/
+typedef struct table_stats
+{
+    char name[ 32 ];
+    ht_stats_t occupancy;
+} table_stats_t;
+
+/**
+ * Wall time per stage and counters of a counting run
+ * Note: Counters are plain sums, threads keep their own counts and add
+ *       them once they finish, so collecting them is always on
+ **/
+typedef struct run_stats
+{
+    double stage_seconds[ NUM_STATS_STAGES ];
+
+    // reference and design kmers taken from sequences
+    uint64_t kmers_extracted;
+
+    // distinct target kmers, summed over window sizes
+    uint64_t unique_kmers;
+
+    // design kmer against target kmer comparisons, and those that matched
+    uint64_t comparisons;
+    uint64_t matches;
+
+    // sizes of the files read in full and of the result files written
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+
+    // hardware event counts of each stage, bit e of perf_events is
+    // set when event e was counted. Stages on the main thread count
+    // the events of every thread
+    uint64_t perf_counts[ NUM_STATS_STAGES ][ NUM_PERF_EVENTS ];
+    unsigned int perf_events;
+
+    table_stats_t tables[ MAX_STATS_TABLES ];
+    int num_tables;
+
+    // walking every per-oligo table of get_kmer_totals for its occupancy
+    // costs time in the counting loop, so it is only done when set
+    bool oligo_table_stats;
+} run_stats_t;
+
+/**
+ * Initializes a run_stats_t with zero times and counts
+ * @param stats pointer to run_stats_t to initialize
+ **/
+void stats_init( run_stats_t *stats );
+
+/**
+ * Gets the current time of a monotonic clock
+ * @returns the time in seconds from an arbitrary start
+ **/
+double stats_time( void );
+
+/**
+ * Adds the time since start to a stage
+ * @param stats pointer to run_stats_t to add to
+ * @param stage stats_stage_t stage to add to
+ * @param start time the stage started, as given by stats_time
+ **/
+void stats_add_time( run_stats_t *stats, stats_stage_t stage, double start );
+
+/**
+ * Adds the hardware events counted since start to a stage
+ * @param stats pointer to run_stats_t to add to
+ * @param stage stats_stage_t stage to add to
+ * @param start array of NUM_PERF_EVENTS counts when the stage started
+ * @param end array of NUM_PERF_EVENTS counts when the stage ended
+ **/
+void stats_add_perf( run_stats_t *stats, stats_stage_t stage,
+                     const uint64_t *start, const uint64_t *end
+                   );
+
+/**
+ * Adds the occupancy of one or more tables to the tables of a run
+ * Note: Occupancies with the same name and window size are summed,
+ *       once MAX_STATS_TABLES kinds are held others are dropped
+ * @param stats pointer to run_stats_t to add to
+ * @param name string kind of table, such as "target"
+ * @param window_size length of the kmers the table holds
+ * @param occupancy pointer to ht_stats_t to add
+ **/
+void stats_add_table( run_stats_t *stats, const char *name, int window_size,
+                      const ht_stats_t *occupancy
+                    );
+
+/**
+ * Gets the name of a stage, as written by stats_write_json
+ * @param stage stats_stage_t stage to name
+ * @returns string name of the stage
+ **/
+const char *stats_stage_name( stats_stage_t stage );
+
+/**
+ * Gets the size of a file
+ * @param file_name string name of the file
+ * @returns the size of the file in bytes, 0 if it cannot be found
+ **/
+uint64_t stats_file_size( const char *file_name );
+
+/**
+ * Writes the stage times and counters of a run as a JSON object
+ * Note: Hardware event counts are written only if perf_events is set,
+ *       table occupancy only if a table was added
+ * @param stats pointer to run_stats_t to write
+ * @param total_seconds wall time of the whole run
+ * @param num_threads number of threads the run used
+ * @param file_name string name of file to write to, "-" for stdout
+ * @returns integer boolean success of operation
+ **/
+int stats_write_json( const run_stats_t *stats, double total_seconds,
+                      int num_threads, const char *file_name
+                    );
+
+#endif
@@ -22,11 +22,30 @@ void set_add( set_t* set_to_add, char* add_data )
 
 int set_remove( set_t* set_to_remove, char* remove_data )
 {
-    void* return_result = ht_delete( set_to_remove->data, remove_data );
+    if( !find_item( set_to_remove->data, remove_data ) )
+        {
+            return 0;
+        }
+
+    ht_delete( set_to_remove->data, remove_data );
+    return 1;
+}
+
+int set_check( set_t* source, char* item )
+{
+    return find_item( source->data, item ) != NULL;
+}
 
-    free( return_result );
+void set_update( set_t* dest, set_t* source )
+{
+    uint32_t index;
+    HT_Entry **found_data = ht_get_items( source->data );
 
-    return return_result == NULL;
+    for( index = 0; index < source->data->size; index++ )
+        {
+            set_add( dest, found_data[ index ]->key );
+        }
+    free( found_data );
 }
 
 void set_clear( set_t* set_to_clear )
@@ -54,7 +73,7 @@ void set_difference( set_t* first, set_t* second )
                    
             if( find_item( second->data, found_data[ index ]->key ) )
                 {
-                    free( ht_delete( first->data, found_data[ index ]->key ) );
+                    ht_delete( first->data, found_data[ index ]->key );
                 }
 
         }
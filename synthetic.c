@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "synthetic.h"
+
+#define NUM_AMINO_ACIDS 20
+
+static const char AMINO_ACIDS[ NUM_AMINO_ACIDS + 1 ] = "ARNDCQEGHILKMFPSTWYV";
+
+// percent of each residue of AMINO_ACIDS in UniProtKB/Swiss-Prot
+static const double AMINO_ACID_FREQUENCIES[ NUM_AMINO_ACIDS ] =
+{
+    8.25, 5.53, 4.06, 5.45, 1.37, 3.93, 6.75, 7.07, 2.27, 5.96,
+    9.66, 5.84, 2.42, 3.86, 4.70, 6.56, 5.34, 1.08, 2.92, 6.87
+};
+
+static uint64_t next_random( uint64_t *state );
+static double random_fraction( uint64_t *state );
+static char random_residue( uint64_t *state, const double *cumulative, double x_fraction );
+static sequence_t *new_sequence( const char *name, const char *residues );
+
+void synthetic_init( synthetic_params_t *params )
+{
+    params->num_proteins  = 200;
+    params->mean_length   = 350;
+    params->redundancy    = 0.1;
+    params->mutation_rate = 0.05;
+    params->x_fraction    = 0.001;
+    params->oligo_length  = 30;
+    params->oligo_step    = 15;
+    params->seed          = 1;
+}
+
+sequence_t **synthetic_proteome( const synthetic_params_t *params )
+{
+    sequence_t **proteome = malloc( params->num_proteins * sizeof( sequence_t * ) );
+    double cumulative[ NUM_AMINO_ACIDS ];
+    double total = 0;
+    uint64_t state = params->seed ? params->seed : 1;
+    char *residues = NULL;
+    char name[ 64 ];
+    unsigned int max_length = params->mean_length + params->mean_length / 2 + 1;
+    unsigned int protein = 0;
+    unsigned int length = 0;
+    unsigned int index = 0;
+    unsigned int source = 0;
+    const char *source_residues = NULL;
+
+    for( index = 0; index < NUM_AMINO_ACIDS; index++ )
+        {
+            total += AMINO_ACID_FREQUENCIES[ index ];
+            cumulative[ index ] = total;
+        }
+    for( index = 0; index < NUM_AMINO_ACIDS; index++ )
+        {
+            cumulative[ index ] /= total;
+        }
+
+    residues = malloc( max_length + 1 );
+    for( protein = 0; protein < params->num_proteins; protein++ )
+        {
+            if( protein && random_fraction( &state ) < params->redundancy )
+                {
+                    // a homolog, which gives the design kmers near matches
+                    source = next_random( &state ) % protein;
+                    source_residues = proteome[ source ]->sequence->data;
+                    length = proteome[ source ]->sequence->size;
+                    for( index = 0; index < length; index++ )
+                        {
+                            residues[ index ] = random_fraction( &state ) < params->mutation_rate
+                                                ? random_residue( &state, cumulative, params->x_fraction )
+                                                : source_residues[ index ];
+                        }
+                    snprintf( name, sizeof( name ), ">synthetic_%u copy_of=%u", protein, source );
+                }
+            else
+                {
+                    length = params->mean_length / 2
+                             + next_random( &state ) % ( params->mean_length + 1 );
+                    if( !length )
+                        {
+                            length = 1;
+                        }
+                    for( index = 0; index < length; index++ )
+                        {
+                            residues[ index ] = random_residue( &state, cumulative, params->x_fraction );
+                        }
+                    snprintf( name, sizeof( name ), ">synthetic_%u", protein );
+                }
+            residues[ length ] = '\0';
+            proteome[ protein ] = new_sequence( name, residues );
+        }
+    free( residues );
+
+    return proteome;
+}
+
+sequence_t **synthetic_library( sequence_t **proteome, int num_proteins,
+                                const synthetic_params_t *params, int *num_oligos
+                              )
+{
+    sequence_t **oligos = NULL;
+    char *oligo = malloc( params->oligo_length + 1 );
+    char name[ 64 ];
+    unsigned int step = params->oligo_step ? params->oligo_step : 1;
+    unsigned int length = 0;
+    unsigned int start = 0;
+    unsigned int count = 0;
+    int protein = 0;
+
+    // oligos start every step residues, plus one ending each protein
+    for( protein = 0; protein < num_proteins; protein++ )
+        {
+            length = proteome[ protein ]->sequence->size;
+            count += length <= params->oligo_length
+                     ? 1 : ( length - params->oligo_length ) / step + 2;
+        }
+    oligos = malloc( count * sizeof( sequence_t * ) );
+
+    count = 0;
+    for( protein = 0; protein < num_proteins; protein++ )
+        {
+            length = proteome[ protein ]->sequence->size;
+            for( start = 0; ; start += step )
+                {
+                    if( start + params->oligo_length > length )
+                        {
+                            start = length > params->oligo_length
+                                    ? length - params->oligo_length : 0;
+                        }
+
+                    snprintf( oligo, params->oligo_length + 1, "%s",
+                              proteome[ protein ]->sequence->data + start
+                            );
+                    snprintf( name, sizeof( name ), ">synthetic_%d_%u", protein, start );
+                    oligos[ count++ ] = new_sequence( name, oligo );
+
+                    if( start + params->oligo_length >= length )
+                        {
+                            break;
+                        }
+                }
+        }
+    free( oligo );
+
+    *num_oligos = count;
+    return oligos;
+}
+
+// xorshift64*, fast and reproducible everywhere
+static uint64_t next_random( uint64_t *state )
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+static double random_fraction( uint64_t *state )
+{
+    return ( next_random( state ) >> 11 ) * ( 1.0 / 9007199254740992.0 );
+}
+
+static char random_residue( uint64_t *state, const double *cumulative, double x_fraction )
+{
+    double fraction = random_fraction( state );
+    int index = 0;
+
+    if( fraction < x_fraction )
+        {
+            return 'X';
+        }
+
+    fraction = random_fraction( state );
+    for( index = 0; index < NUM_AMINO_ACIDS - 1; index++ )
+        {
+            if( fraction < cumulative[ index ] )
+                {
+                    break;
+                }
+        }
+    return AMINO_ACIDS[ index ];
+}
+
+static sequence_t *new_sequence( const char *name, const char *residues )
+{
+    sequence_t *seq = malloc( sizeof( sequence_t ) );
+
+    seq->name = malloc( strlen( name ) + 1 );
+    strcpy( seq->name, name );
+
+    seq->sequence = malloc( sizeof( dynamic_string_t ) );
+    ds_init( seq->sequence );
+    ds_add( seq->sequence, (char *) residues );
+
+    return seq;
+}
@@ -0,0 +1,66 @@
+#ifndef SYNTHETIC_H_INCLUDED
+#define SYNTHETIC_H_INCLUDED
+
+#include <stdint.h>
+
+#include "protein_oligo_library.h"
+
+/**
+ * Size and makeup of a synthetic reference proteome and of the tiled
+ * oligo library designed against it
+ * Note: The same parameters and seed always give the same sequences
+ **/
+typedef struct synthetic_params
+{
+    unsigned int num_proteins;
+
+    // lengths are drawn uniformly between half and one and a half
+    // times mean_length
+    unsigned int mean_length;
+
+    // fraction of proteins that are mutated copies of an earlier
+    // protein, and the fraction of a copy's residues that are changed
+    double redundancy;
+    double mutation_rate;
+
+    // fraction of residues that are X
+    double x_fraction;
+
+    // oligos of oligo_length residues start every oligo_step residues
+    // of each protein, the last one ends at the end of the protein
+    unsigned int oligo_length;
+    unsigned int oligo_step;
+
+    uint64_t seed;
+} synthetic_params_t;
+
+/**
+ * Initializes a synthetic_params_t with a small proteome and a
+ * library of 30 residue oligos overlapping by half
+ * @param params pointer to synthetic_params_t to initialize
+ **/
+void synthetic_init( synthetic_params_t *params );
+
+/**
+ * Generates a proteome whose residues follow the UniProtKB amino acid
+ * frequencies
+ * @param params pointer to synthetic_params_t to generate from
+ * @returns array of params->num_proteins sequences
+ **/
+sequence_t **synthetic_proteome( const synthetic_params_t *params );
+
+/**
+ * Tiles oligos across each protein of a proteome
+ * Note: Proteins shorter than params->oligo_length give one oligo
+ *       holding the whole protein
+ * @param proteome array of proteins to tile
+ * @param num_proteins number of proteins in proteome
+ * @param params pointer to synthetic_params_t giving the tiling
+ * @param num_oligos pointer to integer to store the number of oligos in
+ * @returns array of *num_oligos oligos, in protein order
+ **/
+sequence_t **synthetic_library( sequence_t **proteome, int num_proteins,
+                                const synthetic_params_t *params, int *num_oligos
+                              );
+
+#endif
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "trace.h"
+#include "run_stats.h"
+
+void trace_init( trace_t *trace, int num_threads, uint32_t capacity )
+{
+    int thread = 0;
+
+    trace->num_threads = num_threads;
+    trace->start = stats_time();
+
+    // separate allocations keep each thread's counter off the
+    // cache lines other threads write to
+    trace->buffers = malloc( num_threads * sizeof( trace_buffer_t* ) );
+    for( thread = 0; thread < num_threads; thread++ )
+        {
+            trace->buffers[ thread ] = malloc( sizeof( trace_buffer_t ) );
+            trace->buffers[ thread ]->spans = malloc( capacity * sizeof( trace_span_t ) );
+            trace->buffers[ thread ]->capacity = capacity;
+            trace->buffers[ thread ]->num_recorded = 0;
+        }
+}
+
+void trace_clear( trace_t *trace )
+{
+    int thread = 0;
+
+    for( thread = 0; thread < trace->num_threads; thread++ )
+        {
+            free( trace->buffers[ thread ]->spans );
+            free( trace->buffers[ thread ] );
+        }
+    free( trace->buffers );
+    trace->buffers = NULL;
+    trace->num_threads = 0;
+}
+
+void trace_record( trace_t *trace, int thread, const char *name,
+                   double start, double end
+                 )
+{
+    trace_buffer_t *buffer = NULL;
+    trace_span_t *span = NULL;
+
+    if( !trace || thread < 0 || thread >= trace->num_threads )
+        {
+            return;
+        }
+
+    buffer = trace->buffers[ thread ];
+    span = &buffer->spans[ buffer->num_recorded % buffer->capacity ];
+    span->name  = name;
+    span->start = start;
+    span->end   = end;
+    buffer->num_recorded++;
+}
+
+int trace_write_json( const trace_t *trace, const char *file_name )
+{
+    FILE *out_file = fopen( file_name, "w" );
+    const trace_buffer_t *buffer = NULL;
+    const trace_span_t *span = NULL;
+    uint64_t index = 0;
+    uint64_t first = 0;
+    int thread = 0;
+    int success = 0;
+
+    if( !out_file )
+        {
+            return 0;
+        }
+
+    fprintf( out_file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+    for( thread = 0; thread < trace->num_threads; thread++ )
+        {
+            fprintf( out_file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                     "\"args\":{\"name\":\"thread %d\"}}",
+                     thread ? ",\n" : "", thread, thread
+                   );
+        }
+
+    for( thread = 0; thread < trace->num_threads; thread++ )
+        {
+            buffer = trace->buffers[ thread ];
+
+            // a full buffer starts at its oldest span
+            first = buffer->num_recorded > buffer->capacity
+                    ? buffer->num_recorded - buffer->capacity : 0;
+
+            for( index = first; index < buffer->num_recorded; index++ )
+                {
+                    span = &buffer->spans[ index % buffer->capacity ];
+                    fprintf( out_file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                             "\"ts\":%.3f,\"dur\":%.3f}",
+                             span->name, thread,
+                             ( span->start - trace->start ) * 1e6,
+                             ( span->end - span->start ) * 1e6
+                           );
+                }
+        }
+    fprintf( out_file, "\n]}\n" );
+
+    success = !ferror( out_file );
+    return fclose( out_file ) == 0 && success;
+}
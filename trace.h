@@ -0,0 +1,80 @@
+#ifndef TRACE_H_INCLUDED
+#define TRACE_H_INCLUDED
+
+#include <stdint.h>
+
+// spans each thread keeps before overwriting its oldest
+#define DEFAULT_TRACE_CAPACITY 65536
+
+/**
+ * A span of time one thread spent on one task
+ * Note: name must outlive the trace, spans are given string literals
+ **/
+typedef struct trace_span
+{
+    const char *name;
+    double start;
+    double end;
+} trace_span_t;
+
+/**
+ * Ring buffer of one thread's spans
+ * Note: Only its own thread writes to a buffer, so recording takes no
+ *       locks. Once full, each new span replaces the oldest
+ **/
+typedef struct trace_buffer
+{
+    trace_span_t *spans;
+    uint32_t capacity;
+    uint64_t num_recorded;
+} trace_buffer_t;
+
+/**
+ * Timeline of the spans recorded by each thread of a run
+ **/
+typedef struct trace
+{
+    trace_buffer_t **buffers;
+    int num_threads;
+
+    // time spans are shown relative to, as given by stats_time
+    double start;
+} trace_t;
+
+/**
+ * Initializes a trace_t, allocating a buffer for each thread
+ * @param trace pointer to trace_t to initialize
+ * @param num_threads number of threads that record spans
+ * @param capacity number of spans each thread keeps
+ **/
+void trace_init( trace_t *trace, int num_threads, uint32_t capacity );
+
+/**
+ * Frees the buffers of a trace_t, but not the trace_t itself
+ * @param trace pointer to trace_t to clear
+ **/
+void trace_clear( trace_t *trace );
+
+/**
+ * Records a span on a thread's buffer
+ * Note: Does nothing when trace is NULL or thread has no buffer
+ * @param trace pointer to trace_t to record to, may be NULL
+ * @param thread index of the recording thread
+ * @param name string name of the span
+ * @param start time the span started, as given by stats_time
+ * @param end time the span ended, as given by stats_time
+ **/
+void trace_record( trace_t *trace, int thread, const char *name,
+                   double start, double end
+                 );
+
+/**
+ * Writes the recorded spans as Chrome trace event JSON, which
+ * chrome://tracing and Perfetto can open
+ * @param trace pointer to trace_t to write
+ * @param file_name string name of file to write to
+ * @returns integer boolean success of operation
+ **/
+int trace_write_json( const trace_t *trace, const char *file_name );
+
+#endif